@@ -12,16 +12,13 @@ enum class ALU_Op {
 };
 
 
-class ALU {
-private:
-  uint32_t inst_from_RS;
+struct ALU_Result {
+  uint32_t value;
+  uint32_t next_pc;
+};
 
+class ALU {
 public:
-
-  void set_input(uint32_t request) {
-    inst_from_RS = request;
-  }
-
   uint32_t compute(const std::string& op, uint32_t a, uint32_t b) {
     if (op == "add" || op == "addi") return a + b;
     if (op == "sub") return a - b;
@@ -33,98 +30,40 @@ public:
     if (op == "sra" || op == "srai") return static_cast<int32_t>(a) >> (b & 0x1F);
     if (op == "slt" || op == "slti") return static_cast<int32_t>(a) < static_cast<int32_t>(b) ? 1 : 0;
     if (op == "sltu"|| op == "sltiu") return a < b ? 1 : 0;
-    if (op == "lui") return b << 12;
+    if (op == "lui") return b;   // U 型立即数已经左移过
 
     throw std::runtime_error("Unsupported ALU op: " + op);
   }
 
-  void execute(Instruction& ins, uint32_t val1, uint32_t val2, int rob_id, ROB& rob) {
+  bool branch_taken(const std::string& op, uint32_t a, uint32_t b) {
+    if (op == "beq") return a == b;
+    if (op == "bne") return a != b;
+    if (op == "blt") return static_cast<int32_t>(a) < static_cast<int32_t>(b);
+    if (op == "bge") return static_cast<int32_t>(a) >= static_cast<int32_t>(b);
+    if (op == "bltu") return a < b;
+    if (op == "bgeu") return a >= b;
+    throw std::runtime_error("Unsupported branch op: " + op);
+  }
+
+  // 执行一条非访存指令：val1/val2 为 rs1/rs2 的值，imm 为立即数
+  ALU_Result execute(Instruction& ins, uint32_t pc, uint32_t val1, uint32_t val2, int32_t imm) {
     std::string op = ins.get_op();
-  
-    if (!is_ALU_op(op)) {
+    // 乱序模型只模拟 hart 0：fence 是空操作，CSR 读出 0（mhartid 也是 0）
+    if (op == "fence" || ins.get_type() == 'C') return {0, pc + 4};
+
+    if (!is_ALU_op(op) && op != "auipc") {
       throw std::runtime_error("ALU cannot execute non-ALU op: " + op);
     }
 
-    if (op == "addi") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t imm = ins.get_i_imm();
-    } else if (op == "slti") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t imm = ins.get_i_imm();
-    } else if (op == "sltiu") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t imm = ins.get_i_imm();
-    } else if (op == "xori") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t imm = ins.get_i_imm();
-    } else if (op == "ori") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t imm = ins.get_i_imm();
-    } else if (op == "andi") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t imm = ins.get_i_imm();
-    } else if (op == "slli") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t imm = ins.get_shamt();
-    } else if (op == "srli") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t imm = ins.get_shamt();
-    } else if (op == "srai") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t imm = ins.get_shamt();
-    } else if (op == "add") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-    } else if (op == "sub") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-    } else if (op == "sll") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-    } else if (op == "slt") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-    } else if (op == "sltu") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-    } else if (op == "xor") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-    } else if (op == "srl") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-    } else if (op == "sra") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-    } else if (op == "or") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-    } else if (op == "and") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
+    uint32_t uimm = static_cast<uint32_t>(imm);
+    if (op == "jal") return {pc + 4, pc + uimm};
+    if (op == "jalr") return {pc + 4, val1 + uimm};
+    if (op == "auipc") return {pc + uimm, pc + 4};
+    if (op == "beq" || op == "bne" || op == "blt" || op == "bge" || op == "bltu" || op == "bgeu") {
+      return {0, branch_taken(op, val1, val2) ? pc + uimm : pc + 4};
     }
-  
-    uint32_t result = compute(op, val1, val2);
-    rob.write_result(rob_id, result);
+    if (has_rs2(op)) return {compute(op, val1, val2), pc + 4};
+    return {compute(op, val1, uimm), pc + 4};
   }
 
   bool is_ALU_op(const std::string& op) {
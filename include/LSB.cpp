@@ -2,7 +2,9 @@
 #include <optional>
 #include <cstdint>
 #include <string>
+#include <algorithm>
 #include "ROB.cpp"
+#include "cache.cpp"
 
 enum LSB_Op {
   LB, LBU, LH, LHU, LW, SB, SH, SW
@@ -14,19 +16,27 @@ struct LSB_Entry {
   uint32_t ROB_ID;
   uint32_t addr = 0;
   uint32_t Vj = 0;
-  uint32_t Qj = 0;  // 写入指令依赖的ROB_ID，0表示无依赖
+  uint32_t Qj = 0;  // 地址依赖的 ROB_ID + 1，0表示无依赖
   uint32_t A = 0;   // 偏移量
   uint32_t value = 0;  // store指令要写入内存的值
-  uint32_t Q_val = 0;  // store指令依赖的ROB号，0表示无依赖
-  int execution_cycle = 0;  // 执行周期计数
+  uint32_t Q_val = 0;  // store指令依赖的 ROB_ID + 1，0表示无依赖
+  uint64_t seq = 0;    // 进入 LSB 的顺序，也作为访存请求号
+  bool issued = false; // load 已发往存储层次 / store 已就绪
   uint32_t instruction;
+  uint32_t thread = 0;  // SMT 的线程号，只和同一线程的 store 排序
 
   LSB_Entry() = default;
 
   LSB_Entry(LSB_Op op_, uint32_t rob_id, uint32_t vj, uint32_t qj, uint32_t a, uint32_t inst,
             uint32_t val = 0, uint32_t q_val = 0)
       : busy(true), op(op_), ROB_ID(rob_id), Vj(vj), Qj(qj), A(a),
-        value(val), Q_val(q_val), execution_cycle(0), instruction(inst) {}
+        value(val), Q_val(q_val), instruction(inst) {}
+
+  bool is_load() const { return op >= LB && op <= LW; }
+  bool is_store() const { return op >= SB && op <= SW; }
+
+  // 送进存储层次的地址：各线程地址空间独立，按线程号错开，线程 0 不变
+  uint32_t cache_addr() const { return addr ^ (thread << 26); }
 };
 
 class LoadStoreBuffer {
@@ -34,86 +44,33 @@ private:
   std::vector<std::optional<LSB_Entry>> entries;
   uint32_t capacity;
   uint32_t size = 0;
+  uint64_t next_seq = 1;
+  uint32_t threads = 1;
+  std::vector<uint64_t> oldest_store;   // 每个线程最老的 store
 
 public:
   LoadStoreBuffer() : entries(1024), capacity(1024) {}
   LoadStoreBuffer(uint32_t c) : entries(c), capacity(c) {}
 
-  bool insert_inst(Instruction inst, RegisterFile& regs, ROB& rob) {
-    uint32_t instruction = inst.code;
-    std::string op = inst.get_op();
-    uint32_t rd = inst.get_rd();
-    uint32_t rs1 = inst.get_rs1();
-    uint32_t rs2 = inst.get_rs2();
-    int32_t imm = 0;
-    LSB_Op lsb_op;
-    bool is_store = false;
-    bool is_load = false;
-    if (op == "lb") {
-      lsb_op = LSB_Op::LB;
-      is_load = true;
-      imm = inst.get_i_imm();
-    } else if (op == "lh") {
-      lsb_op = LSB_Op::LH;
-      is_load = true;
-      imm = inst.get_i_imm();
-    } else if (op == "lw") {
-      lsb_op = LSB_Op::LW;
-      is_load = true;
-      imm = inst.get_i_imm();
-    } else if (op == "lbu") {
-      lsb_op = LSB_Op::LBU; 
-      is_load = true;
-      imm = inst.get_i_imm();
-    } else if (op == "lhu") {
-      lsb_op = LSB_Op::LHU;
-      is_load = true;
-      imm = inst.get_i_imm();
-    } else if (op == "sb") {
-      lsb_op = LSB_Op::SB;
-      is_store = true;
-      imm = inst.get_s_imm();
-    } else if (op == "sh") {
-      lsb_op = LSB_Op::SH;
-      is_store = true;
-      imm = inst.get_s_imm();
-    } else if (op == "sw") {
-      lsb_op = LSB_Op::SW;
-      is_store = true;
-      imm = inst.get_s_imm();
-    }
-    if (rob.is_full()) return false;
-    int rob_id = rob.allocate(instruction, rd);
-    if (rob_id == -1) return false;
-
-    if (is_load) regs.set_reorder(rd, rob_id);
-    uint32_t vj = 0, qj = 0;
-    if (!regs.is_pending(rs1)) {
-      vj = regs.read_unsigned(rs1);
-      qj = 0;
-    } else {
-      qj = regs.get_reorder(rs1);
-    }
-    uint32_t val = 0, q_val = 0;
-    if (is_store) {
-      if (!regs.is_pending(rs2)) {
-        val = regs.read_unsigned(rs2);
-        q_val = 0;
-      } else {
-        q_val = regs.get_reorder(rs2);
-      }
-    }
-
-    LSB_Entry entry(lsb_op, rob_id, vj, qj, imm, val, q_val, instruction);
-
-    return insert(entry);
+  static LSB_Op to_lsb_op(const std::string& op) {
+    if (op == "lb") return LSB_Op::LB;
+    if (op == "lbu") return LSB_Op::LBU;
+    if (op == "lh") return LSB_Op::LH;
+    if (op == "lhu") return LSB_Op::LHU;
+    if (op == "lw") return LSB_Op::LW;
+    if (op == "sb") return LSB_Op::SB;
+    if (op == "sh") return LSB_Op::SH;
+    if (op == "sw") return LSB_Op::SW;
+    throw std::runtime_error("Not a load/store op: " + op);
   }
 
   bool insert(const LSB_Entry& entry) {
     for (auto& e : entries) {
       if (!e.has_value()) {
         e = entry;
+        e->seq = next_seq++;
         calculate_address(*e);
+        threads = std::max(threads, e->thread + 1);
         size++;
         return true;
       }
@@ -128,12 +85,12 @@ public:
   void update_operand(uint32_t rob_id, uint32_t val) {
     for (auto& e : entries) {
       if (e.has_value()) {
-        if (e->Qj == rob_id) {
+        if (e->Qj == rob_id + 1) {
           e->Vj = val;
           e->Qj = 0;
           calculate_address(*e);
         }
-        if (e->Q_val == rob_id) {
+        if (e->Q_val == rob_id + 1) {
           e->value = val;
           e->Q_val = 0;
         }
@@ -141,18 +98,11 @@ public:
     }
   }
 
-  std::optional<LSB_Entry> get_ready_entry() {
+  LSB_Entry* find(uint32_t rob_id) {
     for (auto& e : entries) {
-      if (e.has_value() && e->busy) {
-        if ((e->op >= LB && e->op <= LW) && e->Qj == 0) {
-          return e;
-        }
-        if ((e->op >= SB && e->op <= SW) && e->Qj == 0 && e->Q_val == 0) {
-          return e;
-        }
-      }
+      if (e.has_value() && e->ROB_ID == rob_id) return &e.value();
     }
-    return std::nullopt;
+    return nullptr;
   }
 
   void remove(uint32_t rob_id) {
@@ -165,10 +115,35 @@ public:
     }
   }
 
+  void flush() {
+    for (auto& e : entries) {
+      e.reset();
+    }
+    size = 0;
+  }
+
+  // 只冲刷 pred 为真的条目（SMT 中一个线程预测错误）
+  template <typename P>
+  void flush_if(P&& pred) {
+    for (auto& e : entries) {
+      if (e.has_value() && pred(*e)) {
+        e.reset();
+        size--;
+      }
+    }
+  }
+
   bool is_full() const {
     return size == capacity;
   }
 
+  bool is_empty() const {
+    return size == 0;
+  }
+
+  uint32_t get_size() const { return size; }
+  uint32_t get_capacity() const { return capacity; }
+
   bool has_free_entry_for(Instruction& ins) {
     std::string op = ins.get_op();
     if (op == "lb" || op == "lh" || op == "lw" || op == "lbu" || op == "lhu" ||
@@ -178,49 +153,29 @@ public:
     return true;
   }
 
-  int execute(LSB_Entry& e, const Instruction& ins, Memory& mem, ROB& rob) {
-    e.execution_cycle++;
-    if (e.execution_cycle < 3) {
-      return e.execution_cycle;
+  // 读出 load 的结果（按 op 做符号扩展）
+  uint32_t load_value(const LSB_Entry& e, Memory& mem) const {
+    switch (e.op) {
+      case LB: return static_cast<uint32_t>(static_cast<int8_t>(mem.read_byte(e.addr)));
+      case LBU: return static_cast<uint32_t>(mem.read_byte(e.addr));
+      case LH: return static_cast<uint32_t>(static_cast<int16_t>(mem.read_halfword(e.addr)));
+      case LHU: return static_cast<uint32_t>(mem.read_halfword(e.addr));
+      case LW: return mem.read_word(e.addr);
+      default:
+        throw std::runtime_error("Unknown LSB operation");
     }
+  }
 
+  // store 在 ROB 提交时才真正写入内存
+  void write_store(const LSB_Entry& e, Memory& mem) const {
     switch (e.op) {
-      case LB: {
-        int8_t byte = static_cast<int8_t>(mem.read_byte(e.addr));
-        uint32_t data = static_cast<uint32_t>(byte);
-        rob.write_result(e.ROB_ID, data);
-        break;
-      }
-      case LBU: {
-        uint32_t data = static_cast<uint32_t>(mem.read_byte(e.addr));
-        rob.write_result(e.ROB_ID, data);
-        break;
-      }
-      case LH: {
-        int16_t half = static_cast<int16_t>(mem.read_halfword(e.addr));
-        uint32_t data = static_cast<uint32_t>(half);
-        rob.write_result(e.ROB_ID, data);
-        break;
-      }
-      case LHU: {
-        uint32_t data = static_cast<uint32_t>(mem.read_halfword(e.addr));
-        rob.write_result(e.ROB_ID, data);
-        break;
-      }
-      case LW: {
-        uint32_t data = mem.read_word(e.addr);
-        rob.write_result(e.ROB_ID, data);
-        break;
-      }
       case SB: {
         mem.write_byte(e.addr, static_cast<uint8_t>(e.value & 0xFF));
-        rob.write_result(e.ROB_ID, 0);
         break;
       }
       case SH: {
         mem.write_byte(e.addr, static_cast<uint8_t>(e.value & 0xFF));
         mem.write_byte(e.addr + 1, static_cast<uint8_t>((e.value >> 8) & 0xFF));
-        rob.write_result(e.ROB_ID, 0);
         break;
       }
       case SW: {
@@ -228,29 +183,75 @@ public:
         mem.write_byte(e.addr + 1, static_cast<uint8_t>((e.value >> 8) & 0xFF));
         mem.write_byte(e.addr + 2, static_cast<uint8_t>((e.value >> 16) & 0xFF));
         mem.write_byte(e.addr + 3, static_cast<uint8_t>((e.value >> 24) & 0xFF));
-        rob.write_result(e.ROB_ID, 0);
         break;
       }
       default:
         throw std::runtime_error("Unknown LSB operation");
     }
-    e.execution_cycle = 0;
-    return 3;
   }
 
-  void run(Memory& mem, ROB& rob) {
+  // 存储层次返回的 load 完成，结果写入 ROB；被冲刷掉的请求找不到条目，直接忽略。
+  // mem 为空时（trace 回放）load 的值已经预先放在 ROB 条目里
+  bool complete(uint64_t seq, Memory* mem, ROB& rob, uint32_t& rob_id, uint32_t& value) {
+    return complete(seq, [&](const LSB_Entry& e) {
+      rob_id = e.ROB_ID;
+      value = mem != nullptr ? load_value(e, *mem) : rob.get_entry(rob_id).value;
+      rob.get_entry(rob_id).mem_addr = e.addr;
+      rob.write_result(rob_id, value);
+    });
+  }
+
+  // 找到 seq 对应的 load 交给 f 写回，再移出 LSB
+  template <typename F>
+  bool complete(uint64_t seq, F&& f) {
+    for (auto& e : entries) {
+      if (e.has_value() && e->seq == seq) {
+        f(*e);
+        e.reset();
+        size--;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // 每周期最多向存储层次发出一个 load；load 必须等同一线程更早的 store 全部提交。
+  // sent 非空时写入本周期发出的 load 的 ROB 编号，没有则为 -1
+  bool run(MemSystem& ms, ROB& rob, uint64_t now, int* sent = nullptr) {
+    return run(ms, [&rob](uint32_t rob_id) { rob.write_result(rob_id, 0); }, now, sent);
+  }
+
+  // store_ready(ROB 编号) 在 store 的地址和值都就绪时调用
+  template <typename F>
+  bool run(MemSystem& ms, F&& store_ready, uint64_t now, int* sent = nullptr) {
+    if (sent != nullptr) *sent = -1;
+    bool progress = false;
+    oldest_store.assign(threads, UINT64_MAX);
+    for (auto& e : entries) {
+      if (e.has_value() && e->is_store() && e->seq < oldest_store[e->thread]) oldest_store[e->thread] = e->seq;
+    }
+
+    LSB_Entry* next_load = nullptr;
     for (auto& e_opt : entries) {
       if (!e_opt.has_value()) continue;
       auto& e = e_opt.value();
-
-      bool operands_ready = (e.Qj == 0) && (e.op >= LB && e.op <= LW);
-      if (e.busy && operands_ready) {
-        Instruction inst(e.instruction);
-        int stage = execute(e, inst, mem, rob);
-        if (stage == 3) {
-          remove(e.ROB_ID);
+      if (e.issued) continue;
+      if (e.is_store()) {
+        if (e.Qj == 0 && e.Q_val == 0) {
+          store_ready(e.ROB_ID);
+          e.issued = true;
+          progress = true;
         }
+      } else if (e.Qj == 0 && e.seq < oldest_store[e.thread]) {
+        if (next_load == nullptr || e.seq < next_load->seq) next_load = &e;
       }
     }
+
+    if (next_load != nullptr && ms.load(next_load->seq, next_load->cache_addr(), now)) {
+      next_load->issued = true;
+      if (sent != nullptr) *sent = next_load->ROB_ID;
+      progress = true;
+    }
+    return progress;
   }
 };
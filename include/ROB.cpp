@@ -1,4 +1,6 @@
 #include <cstdint>
+#include <tuple>
+#include <stdexcept>
 #include "memory.cpp"
 #include "register.cpp"
 #include "instruction.cpp"
@@ -19,6 +21,11 @@ struct ROB_Entry {
   bool is_taken;
   bool predicted_taken; 
   uint32_t predicted_pc;
+  uint32_t pc = 0;
+  uint32_t next_pc = 0;   // 执行后得到的实际下一条 PC
+  uint32_t mem_addr = 0;  // load 的访存地址
+  bool from_image = false;  // 回放时从镜像取来的指令（错误路径上或 trace 结束之后），没有 oracle 结果
+  bool unsupported = false;  // 乱序模型不支持的 RV32A 指令，提交时才报错，错误路径上的会被冲刷掉
 
   ROB_Entry() = default;
 
@@ -35,7 +42,6 @@ class ROB {
   uint32_t head = 0;
   uint32_t tail = 0;
   uint32_t size = 0;
-  Instruction input = Instruction();
 
  public:
   ROB() : capacity(1024), entries(1024) {}
@@ -45,22 +51,17 @@ class ROB {
   bool is_empty() const { return size == 0; }
   bool has_free_entry() const { return !is_full(); }
 
-  int allocate_reg(uint32_t inst, RegisterFile regs) {
-    Instruction instruction = Instruction(inst);
-    auto dest = instruction.get_rd();
-    int rob_id = allocate(inst, dest);
-    regs.set_reorder(dest, rob_id);
-    return rob_id;
-  }
-
   int allocate(uint32_t ins, uint32_t dest,
                bool is_branch = false, bool is_taken = false,
-               bool predicted_taken = false, uint32_t predicted_pc = 0) {
+               bool predicted_taken = false, uint32_t predicted_pc = 0,
+               uint32_t pc = 0) {
     if (is_full()) return -1;
 
     ROB_Entry entry(true, ROB_State::ISSUE, tail, dest, 0,
                     is_branch, is_taken, predicted_taken, predicted_pc);
     entry.instruction = ins;
+    entry.pc = pc;
+    entry.next_pc = pc + 4;
     entries[tail] = entry;
 
     int allocated_id = tail;
@@ -77,6 +78,22 @@ class ROB {
     return entries[index];
   }
 
+  ROB_Entry& front() {
+    return entries[head];
+  }
+
+  const ROB_Entry& front() const {
+    return entries[head];
+  }
+
+  uint32_t get_size() const { return size; }
+  uint32_t get_capacity() const { return capacity; }
+
+  // 从头部数起的第 i 个条目
+  ROB_Entry& at(uint32_t i) {
+    return entries[(head + i) % capacity];
+  }
+
   void write_result(uint32_t rob_id, uint32_t res) {
     if (rob_id >= capacity || !entries[rob_id].busy) {
       throw std::runtime_error("Invalid ROB ID or entry not busy");
@@ -85,12 +102,19 @@ class ROB {
     entries[rob_id].state = ROB_State::WRITE_RESULT;
   }
 
+  // 分支/跳转指令执行完成，同时写回链接值和实际目标
+  void write_result(uint32_t rob_id, uint32_t res, uint32_t next_pc) {
+    write_result(rob_id, res);
+    entries[rob_id].next_pc = next_pc;
+    entries[rob_id].is_taken = (next_pc != entries[rob_id].pc + 4);
+  }
+
   bool check_mispredict(uint32_t& correct_pc) {
     if (!is_empty()) {
       ROB_Entry &entry = entries[head];
       if (entry.is_branch && entry.state == ROB_State::WRITE_RESULT) {
-        if (entry.is_taken != entry.predicted_taken) {
-          correct_pc = entry.is_taken ? entry.value : entry.predicted_pc;
+        if (entry.next_pc != entry.predicted_pc) {
+          correct_pc = entry.next_pc;
           return true;
         }
       }
@@ -128,29 +152,4 @@ class ROB {
     head = tail;
     size = 0;
   }
-
-  void set_input(Instruction& a) {
-    input = a;
-  }
-
-  Instruction get_input() {
-    return input;
-  }
-
-  void run(Memory& mem, RegisterFile& reg) {
-    uint32_t correct_PC;
-    if (check_mispredict(correct_PC)) {
-      flush();
-      mem.set_PC(correct_PC);
-    }
-
-    if (ready_to_commit()) {
-      auto [rob_id, value, dest] = commit();
-
-      if (dest != 0) {
-        reg.set(dest, value);
-        reg.clear_reorder(dest);
-      }
-    }
-  }
 };
@@ -0,0 +1,224 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+#include <time.h>
+
+// 批量模式：一个进程里用多个线程各自跑一个 CPU 实例，每个程序一个任务
+
+struct BatchJob {
+  std::string path;
+  std::string label;   // 清单里的原始行
+  Cache_Config l1;
+  DRAM_Config dram;
+  Core_Config core;
+};
+
+struct BatchResult {
+  std::string status = "error";   // halted / limit / error
+  std::string error;
+  uint32_t exit_code = 0;
+  std::map<std::string, uint64_t> counters;
+  double seconds = 0;
+  double cpu_seconds = 0;   // 运行这个任务的线程占用的 CPU 时间
+};
+
+// 当前线程占用的 CPU 时间；线程数多于核数时它比墙钟时间少
+inline double thread_cpu_seconds() {
+  timespec ts;
+  ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// 每行一个程序镜像，后面可以跟存储层次的选项，例如 "tests/qsort.data --l1-size=8192"。
+// 相对路径以清单所在目录为基准；空行和 # 开头的行跳过
+inline std::vector<BatchJob> load_batch_manifest(const std::string& manifest, const Cache_Config& l1,
+                                                 const DRAM_Config& dram, const Core_Config& core) {
+  std::ifstream in(manifest);
+  if (!in) throw std::runtime_error("Cannot open batch manifest: " + manifest);
+  std::string dir;
+  size_t slash = manifest.rfind('/');
+  if (slash != std::string::npos) dir = manifest.substr(0, slash + 1);
+  std::vector<BatchJob> jobs;
+  std::string line;
+  while (std::getline(in, line)) {
+    size_t first = line.find_first_not_of(" \t");
+    if (first == std::string::npos || line[first] == '#') continue;
+    std::istringstream ss(line);
+    BatchJob job{"", line.substr(first), l1, dram, core};
+    ss >> job.path;
+    if (job.path[0] != '/') job.path = dir + job.path;
+    std::string arg;
+    while (ss >> arg) {
+      if (!parse_config_option(arg.c_str(), job.l1, job.dram, job.core)) {
+        throw std::runtime_error("unknown option in batch manifest: " + arg);
+      }
+    }
+    jobs.push_back(job);
+  }
+  return jobs;
+}
+
+class BatchRunner {
+ private:
+  // 每个线程一个任务队列，自己从队头取，空了再从别的队列尾部偷
+  struct Queue {
+    std::mutex lock;
+    std::deque<size_t> items;
+  };
+
+  const std::vector<BatchJob>& jobs;
+  bool ooo;
+  bool skip_idle;
+  uint64_t max_insts;
+  std::vector<BatchResult> results;
+  std::vector<Queue> queues;
+  std::function<void(size_t, const BatchResult&)> on_done;
+  ResultCache* cache = nullptr;
+  std::mutex done_lock;
+  double wall = 0;
+
+  bool take(size_t self, size_t& job) {
+    {
+      std::lock_guard<std::mutex> guard(queues[self].lock);
+      if (!queues[self].items.empty()) {
+        job = queues[self].items.front();
+        queues[self].items.pop_front();
+        return true;
+      }
+    }
+    for (size_t k = 1; k < queues.size(); ++k) {
+      Queue& victim = queues[(self + k) % queues.size()];
+      std::lock_guard<std::mutex> guard(victim.lock);
+      if (!victim.items.empty()) {
+        job = victim.items.back();
+        victim.items.pop_back();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void run_one(const BatchJob& job, BatchResult& r) const {
+    auto start = std::chrono::steady_clock::now();
+    double cpu_start = thread_cpu_seconds();
+    try {
+      std::ifstream in(job.path);
+      if (!in) throw std::runtime_error("cannot open " + job.path);
+      CPU cpu(job.l1, job.dram, job.core);
+      cpu.set_output(nullptr);
+      uint32_t lo, hi;
+      load_image(cpu, in, lo, hi);
+      cpu.cpu_set_PC(0x0);
+      std::string key;
+      CachedResult cached;
+      if (cache != nullptr) {
+        key = cache->key(cpu, (ooo ? "ooo " : "functional ") + std::to_string(max_insts),
+                         config_key(job.l1, job.dram, job.core));
+      }
+      if (cache == nullptr || !cache->lookup(key, cached)) {
+        if (ooo) {
+          cpu.run(skip_idle, max_insts);
+        } else {
+          cached.counters.push_back({"instructions", cpu.run_functional(max_insts)});
+        }
+        CachedResult final_state = capture_result(cpu, ooo);
+        final_state.counters.insert(final_state.counters.end(), cached.counters.begin(), cached.counters.end());
+        cached = final_state;
+        if (cache != nullptr) cache->store(key, cached);
+      }
+      for (const auto& [name, value] : cached.counters) r.counters[name] = value;
+      r.status = cached.halted ? "halted" : "limit";
+      r.exit_code = cached.exit_code;
+    } catch (const std::exception& e) {
+      r.status = "error";
+      r.error = e.what();
+    }
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    r.cpu_seconds = thread_cpu_seconds() - cpu_start;
+  }
+
+  void worker(size_t self) {
+    size_t job;
+    while (take(self, job)) {
+      run_one(jobs[job], results[job]);
+      if (on_done) {
+        std::lock_guard<std::mutex> guard(done_lock);
+        on_done(job, results[job]);
+      }
+    }
+  }
+
+ public:
+  BatchRunner(const std::vector<BatchJob>& j, bool detailed, bool skip, uint64_t limit)
+      : jobs(j), ooo(detailed), skip_idle(skip), max_insts(limit), results(j.size()) {}
+
+  void set_cache(ResultCache* c) {
+    cache = c;
+  }
+
+  // 每个任务完成时调用，调用之间互斥
+  void set_callback(std::function<void(size_t, const BatchResult&)> f) {
+    on_done = std::move(f);
+  }
+
+  void run(unsigned threads) {
+    threads = std::max(1u, std::min<unsigned>(threads, jobs.size()));
+    queues = std::vector<Queue>(threads);
+    for (size_t i = 0; i < jobs.size(); ++i) queues[i % threads].items.push_back(i);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; ++t) pool.emplace_back(&BatchRunner::worker, this, t);
+    for (auto& t : pool) t.join();
+    wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  // 结果表写到 os，汇总一行写到 summary，返回出错或没有停机的任务数
+  size_t report(std::ostream& os, std::ostream& summary) {
+    size_t failed = 0;
+    double busy = 0;
+    os << std::fixed << std::setprecision(3);
+    os << "job  status   output  instructions      cycles    ipc  mispredicts   l1d_misses   seconds  program\n";
+    for (size_t i = 0; i < jobs.size(); ++i) {
+      BatchResult& r = results[i];
+      busy += r.cpu_seconds;
+      if (r.status != "halted") failed++;
+      os << std::setw(3) << i << "  " << std::left << std::setw(7) << r.status << std::right << "  ";
+      if (r.status == "error") {
+        os << std::setw(75) << r.seconds << "  " << jobs[i].label << "  # " << r.error << "\n";
+        continue;
+      }
+      uint64_t cycles = r.counters["cycles"];
+      os << std::setw(6);
+      if (r.status == "halted") {
+        os << r.exit_code;
+      } else {
+        os << "-";
+      }
+      os << "  " << std::setw(12) << r.counters["instructions"] << "  ";
+      if (ooo) {
+        os << std::setw(10) << cycles << "  " << std::setw(5)
+           << (cycles ? static_cast<double>(r.counters["instructions"]) / cycles : 0.0) << "  " << std::setw(11)
+           << r.counters["branch_mispredicts"] << "  " << std::setw(11) << r.counters["l1d.misses"];
+      } else {
+        os << std::setw(10) << "-" << "  " << std::setw(5) << "-" << "  " << std::setw(11) << "-" << "  "
+           << std::setw(11) << "-";
+      }
+      os << "  " << std::setw(8) << r.seconds << "  " << jobs[i].label << "\n";
+    }
+    os.unsetf(std::ios::fixed);
+    summary << jobs.size() << " jobs on " << queues.size() << " threads, " << failed << " not halted, wall " << wall
+            << " s, cpu " << busy << " s, speedup " << (wall > 0 ? busy / wall : 0.0) << std::endl;
+    return failed;
+  }
+};
@@ -0,0 +1,283 @@
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <stdexcept>
+#include "dram.cpp"
+
+// 组相联、LRU、写回写分配的数据 cache，缺失由 DRAM 时序模型服务
+// 同 DRAM 一样只建模时间，数据仍在 Memory 中
+
+struct Cache_Config {
+  uint32_t size = 32 * 1024;
+  uint32_t ways = 8;
+  uint32_t line_size = 64;
+  uint32_t hit_latency = 3;
+  uint32_t mshrs = 16;        // 同时未完成的缺失行数
+};
+
+struct Cache_Line {
+  bool valid = false;
+  bool dirty = false;
+  uint32_t tag = 0;
+  uint64_t lru = 0;
+};
+
+class Cache {
+ private:
+  Cache_Config config;
+  uint32_t sets;
+  std::vector<Cache_Line> lines;
+  uint64_t stamp = 0;
+
+  uint64_t accesses = 0;
+  uint64_t misses = 0;
+  uint64_t writebacks = 0;
+
+  Cache_Line* find(uint32_t addr) {
+    uint32_t line = addr / config.line_size;
+    uint32_t set = line % sets;
+    uint32_t tag = line / sets;
+    for (uint32_t w = 0; w < config.ways; ++w) {
+      Cache_Line& l = lines[set * config.ways + w];
+      if (l.valid && l.tag == tag) return &l;
+    }
+    return nullptr;
+  }
+
+  // 按 LRU 选出替换的行并填入，不计入统计
+  bool replace(uint32_t addr, bool dirty, uint32_t& victim) {
+    uint32_t line = addr / config.line_size;
+    uint32_t set = line % sets;
+    uint32_t tag = line / sets;
+    Cache_Line* target = nullptr;
+    for (uint32_t w = 0; w < config.ways; ++w) {
+      Cache_Line& l = lines[set * config.ways + w];
+      if (!l.valid) {
+        target = &l;
+        break;
+      }
+      if (target == nullptr || l.lru < target->lru) target = &l;
+    }
+    bool evict = target->valid && target->dirty;
+    if (evict) victim = (target->tag * sets + set) * config.line_size;
+    target->valid = true;
+    target->dirty = dirty;
+    target->tag = tag;
+    target->lru = ++stamp;
+    return evict;
+  }
+
+ public:
+  Cache() : Cache(Cache_Config()) {}
+  Cache(const Cache_Config& c)
+      : config(c), sets(c.ways && c.line_size ? c.size / (c.line_size * c.ways) : 0), lines(sets * c.ways) {
+    if (sets == 0) throw std::runtime_error("Cache size must be at least ways * line_size");
+  }
+
+  const Cache_Config& get_config() const { return config; }
+
+  bool probe(uint32_t addr) {
+    return find(addr) != nullptr;
+  }
+
+  // 计入统计的访问，命中时更新 LRU 和 dirty
+  bool access(uint32_t addr, bool is_write) {
+    accesses++;
+    Cache_Line* l = find(addr);
+    if (l == nullptr) {
+      misses++;
+      return false;
+    }
+    l->lru = ++stamp;
+    if (is_write) l->dirty = true;
+    return true;
+  }
+
+  // 填入一行，被替换的脏行地址写入 victim 并返回 true
+  bool fill(uint32_t addr, bool dirty, uint32_t& victim) {
+    bool evict = replace(addr, dirty, victim);
+    if (evict) writebacks++;
+    return evict;
+  }
+
+  // 功能预热：不计统计、不计时地访问一次，缺失时直接填入
+  void warm(uint32_t addr, bool is_write) {
+    Cache_Line* l = find(addr);
+    if (l == nullptr) {
+      uint32_t victim;
+      replace(addr, is_write, victim);
+      return;
+    }
+    l->lru = ++stamp;
+    if (is_write) l->dirty = true;
+  }
+
+  void register_stats(StatRegistry& stats, const std::string& name) {
+    stats.add_counter(name + ".accesses", &accesses);
+    stats.add_counter(name + ".misses", &misses);
+    stats.add_counter(name + ".writebacks", &writebacks);
+  }
+
+  uint64_t get_accesses() const { return accesses; }
+  uint64_t get_misses() const { return misses; }
+  uint64_t get_writebacks() const { return writebacks; }
+};
+
+struct MSHR {
+  uint32_t line;
+  uint64_t dram_id;
+  bool dirty;
+  std::vector<uint64_t> waiting;   // 等待这一行的 load 请求
+};
+
+struct Pending_Hit {
+  uint64_t id;
+  uint64_t ready_at;
+};
+
+// LSB 看到的存储层次：L1D + DRAM
+class MemSystem {
+ private:
+  Cache l1;
+  DRAM dram;
+  std::vector<Pending_Hit> hits;
+  std::vector<MSHR> mshrs;
+  std::deque<uint32_t> writebacks;   // 等待进入 DRAM 队列的脏行
+  uint64_t next_dram_id = 1;
+  std::vector<uint64_t> dram_done;
+  EventQueue* events = nullptr;
+
+  uint32_t line_of(uint32_t addr) const {
+    uint32_t size = l1.get_config().line_size;
+    return addr / size * size;
+  }
+
+  MSHR* find_mshr(uint32_t line) {
+    for (auto& m : mshrs) {
+      if (m.line == line) return &m;
+    }
+    return nullptr;
+  }
+
+  // 为一行分配 MSHR 并向 DRAM 发出读请求，资源不足返回 nullptr
+  MSHR* start_miss(uint32_t line, uint64_t now) {
+    if (mshrs.size() >= l1.get_config().mshrs || !dram.can_accept(line)) return nullptr;
+    uint64_t id = next_dram_id++;
+    dram.enqueue(id, line, false, now);
+    mshrs.push_back({line, id, false, {}});
+    return &mshrs.back();
+  }
+
+ public:
+  MemSystem() = default;
+  MemSystem(const Cache_Config& c, const DRAM_Config& d) : l1(c), dram(d) {}
+
+  void set_events(EventQueue* e) {
+    events = e;
+    dram.set_events(e);
+  }
+
+  // 发起一次 load，请求完成时 id 会出现在 tick 的 done 中；返回 false 表示本周期无法接收
+  bool load(uint64_t id, uint32_t addr, uint64_t now) {
+    uint32_t line = line_of(addr);
+    if (l1.probe(line)) {
+      l1.access(line, false);
+      uint64_t ready_at = now + l1.get_config().hit_latency;
+      hits.push_back({id, ready_at});
+      if (events != nullptr) events->schedule(ready_at);
+      return true;
+    }
+    MSHR* m = find_mshr(line);
+    if (m == nullptr) {
+      m = start_miss(line, now);
+      if (m == nullptr) return false;
+    }
+    l1.access(line, false);
+    m->waiting.push_back(id);
+    return true;
+  }
+
+  // store 在提交时写入，不等待填充完成；返回 false 表示本周期无法接收
+  bool store(uint32_t addr, uint64_t now) {
+    uint32_t line = line_of(addr);
+    if (l1.probe(line)) {
+      l1.access(line, true);
+      return true;
+    }
+    MSHR* m = find_mshr(line);
+    if (m == nullptr) {
+      m = start_miss(line, now);
+      if (m == nullptr) return false;
+    }
+    l1.access(line, true);
+    m->dirty = true;
+    return true;
+  }
+
+  // 返回本周期状态是否有变化
+  bool tick(uint64_t now, std::vector<uint64_t>& done) {
+    bool progress = false;
+    while (!writebacks.empty() && dram.can_accept(writebacks.front())) {
+      dram.enqueue(next_dram_id++, writebacks.front(), true, now);
+      writebacks.pop_front();
+      progress = true;
+    }
+
+    dram_done.clear();
+    if (dram.tick(now, dram_done)) progress = true;
+    for (uint64_t id : dram_done) {
+      for (size_t i = 0; i < mshrs.size(); ++i) {
+        if (mshrs[i].dram_id != id) continue;
+        uint32_t victim;
+        if (l1.fill(mshrs[i].line, mshrs[i].dirty, victim)) {
+          writebacks.push_back(victim);
+        }
+        done.insert(done.end(), mshrs[i].waiting.begin(), mshrs[i].waiting.end());
+        mshrs.erase(mshrs.begin() + i);
+        break;
+      }
+    }
+
+    for (size_t i = 0; i < hits.size();) {
+      if (hits[i].ready_at <= now) {
+        done.push_back(hits[i].id);
+        hits.erase(hits.begin() + i);
+        progress = true;
+      } else {
+        ++i;
+      }
+    }
+    return progress;
+  }
+
+  void set_dram_log(std::vector<DRAM_Access>* log) {
+    dram.set_log(log);
+  }
+
+  void warm(uint32_t addr, bool is_write) {
+    l1.warm(line_of(addr), is_write);
+  }
+
+  const Cache& get_l1() const { return l1; }
+
+  void register_stats(StatRegistry& stats) {
+    l1.register_stats(stats, "l1d");
+    dram.register_stats(stats);
+  }
+
+  bool is_idle() const {
+    return hits.empty() && mshrs.empty() && writebacks.empty() && dram.is_idle();
+  }
+
+  void print_stats(std::ostream& os, uint64_t cycles) const {
+    uint64_t acc = l1.get_accesses();
+    double miss_rate = acc ? static_cast<double>(l1.get_misses()) / acc : 0.0;
+    os << "l1d.accesses " << acc << "\n"
+       << "l1d.misses " << l1.get_misses() << "\n"
+       << "l1d.writebacks " << l1.get_writebacks() << "\n"
+       << std::fixed << std::setprecision(2)
+       << "l1d.miss_rate " << miss_rate * 100 << "%\n";
+    os.unsetf(std::ios::fixed);
+    dram.print_stats(os, cycles);
+  }
+};
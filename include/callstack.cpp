@@ -0,0 +1,127 @@
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <iomanip>
+
+// 影子调用栈：jal/jalr 且 rd=ra 视为调用，jalr x0, 0(ra) 视为返回。
+// 调用路径保存为一棵树，每个节点是一条完整的调用路径
+struct CallNode {
+  uint32_t func;       // 函数入口地址
+  int parent;
+  uint64_t insts = 0;  // 自身（不含被调用者）的指令数
+  uint64_t cycles = 0; // 自身的周期数，只有乱序模型会统计
+};
+
+class CallProfiler {
+ private:
+  std::vector<CallNode> nodes;
+  std::unordered_map<uint64_t, int> children;   // (parent << 32 | func) -> 节点
+  int current = 0;
+  bool has_cycles = false;
+
+  static bool is_call(uint32_t code) {
+    uint32_t opcode = code & 0x7F, rd = (code >> 7) & 0x1F;
+    return (opcode == 0b1101111 || opcode == 0b1100111) && rd == 1;
+  }
+
+  static bool is_return(uint32_t code) {
+    uint32_t opcode = code & 0x7F, rd = (code >> 7) & 0x1F, rs1 = (code >> 15) & 0x1F;
+    return opcode == 0b1100111 && rd == 0 && rs1 == 1 && (code >> 20) == 0;
+  }
+
+  std::string func_name(uint32_t func, const SymbolTable* syms) const {
+    if (syms != nullptr) {
+      int i = syms->find(func);
+      if (i >= 0 && syms->address(i) == func) return syms->name(i);
+    }
+    std::ostringstream ss;
+    ss << "0x" << std::hex << std::setw(8) << std::setfill('0') << func;
+    return ss.str();
+  }
+
+  uint64_t cost(const CallNode& n) const {
+    return has_cycles ? n.cycles : n.insts;
+  }
+
+ public:
+  CallProfiler(uint32_t entry) {
+    nodes.push_back({entry, -1});
+  }
+
+  // 每条提交的指令调用一次，next_pc 为其实际的下一条 PC
+  void on_retire(uint32_t code, uint32_t next_pc) {
+    nodes[current].insts++;
+    if (is_call(code)) {
+      uint64_t key = (static_cast<uint64_t>(current) << 32) | next_pc;
+      auto it = children.find(key);
+      if (it == children.end()) {
+        nodes.push_back({next_pc, current});
+        it = children.emplace(key, static_cast<int>(nodes.size()) - 1).first;
+      }
+      current = it->second;
+    } else if (is_return(code) && nodes[current].parent >= 0) {
+      current = nodes[current].parent;
+    }
+  }
+
+  void add_cycles(uint64_t n) {
+    has_cycles = true;
+    nodes[current].cycles += n;
+  }
+
+  // folded stack 格式，每行 "f1;f2;f3 cost"，可直接交给 flamegraph.pl 等工具
+  void write_folded(std::ostream& os, const SymbolTable* syms) const {
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      uint64_t c = cost(nodes[i]);
+      if (c == 0) continue;
+      std::vector<std::string> path;
+      for (int n = static_cast<int>(i); n >= 0; n = nodes[n].parent) {
+        path.push_back(func_name(nodes[n].func, syms));
+      }
+      for (size_t j = path.size(); j-- > 0;) {
+        os << path[j] << (j ? ";" : " ");
+      }
+      os << c << "\n";
+    }
+  }
+
+  // 每个函数的自身/包含开销；递归调用只在最外层计入包含开销
+  void write_functions(std::ostream& os, const SymbolTable* syms) const {
+    std::vector<uint64_t> subtree(nodes.size(), 0);
+    for (size_t i = nodes.size(); i-- > 0;) {
+      subtree[i] += cost(nodes[i]);
+      if (nodes[i].parent >= 0) subtree[nodes[i].parent] += subtree[i];
+    }
+    std::unordered_map<uint32_t, std::pair<uint64_t, uint64_t>> funcs;   // func -> (exclusive, inclusive)
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      auto& f = funcs[nodes[i].func];
+      f.first += cost(nodes[i]);
+      bool outermost = true;
+      for (int p = nodes[i].parent; p >= 0; p = nodes[p].parent) {
+        if (nodes[p].func == nodes[i].func) {
+          outermost = false;
+          break;
+        }
+      }
+      if (outermost) f.second += subtree[i];
+    }
+    std::vector<std::pair<uint32_t, std::pair<uint64_t, uint64_t>>> order(funcs.begin(), funcs.end());
+    std::sort(order.begin(), order.end(), [](const auto& a, const auto& b) {
+      if (a.second.second != b.second.second) return a.second.second > b.second.second;
+      return a.first < b.first;
+    });
+    uint64_t total = subtree.empty() ? 0 : subtree[0];
+    os << std::fixed << std::setprecision(2);
+    os << "# " << (has_cycles ? "cycles" : "instructions") << " per function, total " << total << "\n";
+    os << "   inclusive      %     exclusive      %   function\n";
+    for (const auto& f : order) {
+      uint64_t inc = f.second.second, exc = f.second.first;
+      os << std::setw(12) << inc << "  " << std::setw(6) << (total ? 100.0 * inc / total : 0.0)
+         << "  " << std::setw(12) << exc << "  " << std::setw(6) << (total ? 100.0 * exc / total : 0.0)
+         << "   " << func_name(f.first, syms) << "\n";
+    }
+    os.unsetf(std::ios::fixed);
+  }
+};
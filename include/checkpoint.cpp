@@ -0,0 +1,113 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <memory>
+#include <vector>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// 体系结构状态的 checkpoint。文件布局都按 4KB 对齐，恢复时整个文件 mmap 进来，
+// 内存页直接指向映射区，实际读到哪页才由内核载入哪页，所以恢复时间与程序规模无关：
+//   [0, 4096)       头部：magic、版本、PC、已执行指令数、32 个寄存器、页数、父 checkpoint
+//   之后            页号表（uint32），补齐到 4KB
+//   之后            各页内容，每页 4KB
+// 增量 checkpoint 只保存上一个 checkpoint 之后写过的页，头部记下父文件名（与本文件同目录），
+// 恢复时先沿链恢复父文件，再把本文件的页盖上去
+
+const char CHECKPOINT_MAGIC[8] = {'R', 'V', 'C', 'K', 'P', 'T', '\0', '\0'};
+const uint32_t CHECKPOINT_VERSION = 1;
+
+struct CheckpointHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t pc;
+  uint64_t instructions;
+  uint32_t regs[32];
+  uint32_t page_count;
+  char parent[256];      // 空串表示完整 checkpoint
+};
+
+inline uint64_t checkpoint_align(uint64_t n) {
+  return (n + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+}
+
+inline std::string checkpoint_basename(const std::string& path) {
+  size_t slash = path.rfind('/');
+  return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+inline std::string checkpoint_dirname(const std::string& path) {
+  size_t slash = path.rfind('/');
+  return slash == std::string::npos ? "" : path.substr(0, slash + 1);
+}
+
+// parent 非空时保存增量 checkpoint，只写 mem 中的脏页
+inline void save_checkpoint(const std::string& path, const Memory& mem, const RegisterFile& regs,
+                            uint64_t instructions, const std::string& parent = "") {
+  std::string parent_name = checkpoint_basename(parent);
+  if (parent_name.size() >= sizeof(CheckpointHeader::parent)) {
+    throw std::runtime_error("Checkpoint file name too long: " + parent);
+  }
+  FILE* out = std::fopen(path.c_str(), "wb");
+  if (out == nullptr) throw std::runtime_error("Cannot open checkpoint file: " + path);
+  std::vector<uint32_t> tags = parent.empty() ? mem.page_numbers() : mem.dirty_pages();
+  CheckpointHeader h{};
+  std::memcpy(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic));
+  h.version = CHECKPOINT_VERSION;
+  h.pc = mem.get_PC();
+  h.instructions = instructions;
+  for (uint32_t i = 0; i < 32; ++i) h.regs[i] = regs.read_unsigned(i);
+  h.page_count = static_cast<uint32_t>(tags.size());
+  std::memcpy(h.parent, parent_name.c_str(), parent_name.size() + 1);
+
+  std::vector<uint8_t> head(PAGE_SIZE + checkpoint_align(tags.size() * sizeof(uint32_t)), 0);
+  std::memcpy(head.data(), &h, sizeof(h));
+  if (!tags.empty()) std::memcpy(head.data() + PAGE_SIZE, tags.data(), tags.size() * sizeof(uint32_t));
+  bool ok = std::fwrite(head.data(), 1, head.size(), out) == head.size();
+  for (uint32_t tag : tags) {
+    ok = ok && std::fwrite(mem.page_data(tag), 1, PAGE_SIZE, out) == PAGE_SIZE;
+  }
+  if (std::fclose(out) != 0 || !ok) throw std::runtime_error("Cannot write checkpoint file: " + path);
+}
+
+// 返回 checkpoint 时已执行的指令数
+inline uint64_t restore_checkpoint(const std::string& path, Memory& mem, RegisterFile& regs, int depth = 0) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) throw std::runtime_error("Cannot open checkpoint file: " + path);
+  struct stat st;
+  ::fstat(fd, &st);
+  size_t size = st.st_size;
+  // MAP_PRIVATE 加可写：即使某页被就地写入，改动也只在本进程里，不会写回文件
+  void* p = size >= PAGE_SIZE ? ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+  ::close(fd);
+  if (p == MAP_FAILED) throw std::runtime_error("Not a checkpoint file: " + path);
+  std::shared_ptr<uint8_t> mapping(static_cast<uint8_t*>(p), [size](uint8_t* base) { ::munmap(base, size); });
+
+  CheckpointHeader h;
+  std::memcpy(&h, mapping.get(), sizeof(h));
+  uint64_t data = PAGE_SIZE + checkpoint_align(static_cast<uint64_t>(h.page_count) * sizeof(uint32_t));
+  if (std::memcmp(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic)) != 0 || h.version != CHECKPOINT_VERSION ||
+      data + static_cast<uint64_t>(h.page_count) * PAGE_SIZE > size) {
+    throw std::runtime_error("Not a checkpoint file: " + path);
+  }
+  const uint32_t* tags = reinterpret_cast<const uint32_t*>(mapping.get() + PAGE_SIZE);
+  h.parent[sizeof(h.parent) - 1] = '\0';
+  if (h.parent[0] == '\0') {
+    mem.clear();
+  } else {
+    if (depth >= 4096) throw std::runtime_error("Checkpoint chain too long: " + path);
+    restore_checkpoint(checkpoint_dirname(path) + h.parent, mem, regs, depth + 1);
+  }
+  for (uint32_t i = 0; i < h.page_count; ++i) {
+    // 与 mapping 共用引用计数，最后一页不再使用时整个文件才解除映射
+    mem.map_page(tags[i], std::shared_ptr<uint8_t>(mapping, mapping.get() + data + static_cast<uint64_t>(i) * PAGE_SIZE));
+  }
+  mem.set_PC(h.pc);
+  for (uint32_t i = 0; i < 32; ++i) regs.set(i, h.regs[i]);
+  mem.clear_dirty();
+  return h.instructions;
+}
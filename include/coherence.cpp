@@ -0,0 +1,266 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+
+// 多 hart 的 MESI 一致性模型（目录式）：每个 hart 一个私有 L1（组相联、LRU），目录记录每行的共享者和持有者。
+// 功能模拟时各 hart 的访存经 trace 接口按发生顺序送进来，只统计一致性事件，不计时。
+// 被别的 hart 写失效之后再次缺失的算一致性缺失；如果这次访问的字节在失效后没有被别人写过，
+// 这一行只是被不同数据共用，记为伪共享，并记下缺失和写失效它的 PC
+
+enum class MESI : uint8_t { I, S, E, M };
+
+struct CoherenceStats {
+  uint64_t accesses = 0;
+  uint64_t misses = 0;            // 冷缺失和容量缺失
+  uint64_t coherence_misses = 0;
+  uint64_t false_sharing = 0;
+  uint64_t upgrades = 0;          // S 上的写，需要失效其他副本
+  uint64_t invalidations = 0;     // 收到的失效
+  uint64_t downgrades = 0;        // 收到的降级（M/E -> S）
+  uint64_t writebacks = 0;        // 替换、失效或降级时写回的脏行
+};
+
+class CoherenceModel {
+ private:
+  struct Line {
+    uint32_t tag = 0;
+    MESI state = MESI::I;
+    uint64_t lru = 0;
+  };
+
+  struct PrivateCache {
+    std::vector<Line> lines;
+    uint64_t stamp = 0;
+    CoherenceStats stats;
+  };
+
+  // 一行被某个 hart 失去后的记录：失效它的写的 PC，以及之后被别人写过的字节
+  struct Lost {
+    uint32_t writer_pc = 0;
+    uint64_t written = 0;
+  };
+
+  struct DirEntry {
+    uint64_t sharers = 0;   // 持有副本的 hart
+    int owner = -1;         // 处于 E/M 的 hart
+    std::map<uint32_t, Lost> lost;   // hart -> 记录
+  };
+
+  struct FalseSharing {
+    uint64_t count = 0;
+    std::map<uint32_t, uint64_t> miss_pcs;
+    std::map<uint32_t, uint64_t> writer_pcs;
+  };
+
+  Cache_Config config;
+  uint32_t sets;
+  std::vector<PrivateCache> caches;
+  std::unordered_map<uint32_t, DirEntry> directory;   // 行号 -> 目录项
+  std::map<uint32_t, FalseSharing> false_sharing;     // 行地址 -> 统计
+  std::mutex lock;
+
+  Line* find(uint32_t hart, uint32_t line) {
+    uint32_t set = line % sets;
+    for (uint32_t w = 0; w < config.ways; ++w) {
+      Line& l = caches[hart].lines[set * config.ways + w];
+      if (l.state != MESI::I && l.tag == line / sets) return &l;
+    }
+    return nullptr;
+  }
+
+  // 目录向 hart 发失效，脏行写回
+  void invalidate(uint32_t hart, uint32_t line, uint32_t writer_pc) {
+    Line* l = find(hart, line);
+    if (l == nullptr) return;
+    if (l->state == MESI::M) caches[hart].stats.writebacks++;
+    l->state = MESI::I;
+    caches[hart].stats.invalidations++;
+    DirEntry& d = directory[line];
+    d.sharers &= ~(1ull << hart);
+    if (d.owner == static_cast<int>(hart)) d.owner = -1;
+    d.lost[hart] = {writer_pc, 0};
+  }
+
+  // 替换出 hart 的一行，给 line 腾出位置
+  Line& allocate(uint32_t hart, uint32_t line) {
+    uint32_t set = line % sets;
+    Line* target = nullptr;
+    for (uint32_t w = 0; w < config.ways; ++w) {
+      Line& l = caches[hart].lines[set * config.ways + w];
+      if (l.state == MESI::I) {
+        target = &l;
+        break;
+      }
+      if (target == nullptr || l.lru < target->lru) target = &l;
+    }
+    if (target->state != MESI::I) {
+      uint32_t victim = target->tag * sets + set;
+      if (target->state == MESI::M) caches[hart].stats.writebacks++;
+      DirEntry& d = directory[victim];
+      d.sharers &= ~(1ull << hart);
+      if (d.owner == static_cast<int>(hart)) d.owner = -1;
+    }
+    target->tag = line / sets;
+    return *target;
+  }
+
+  // 缺失时判断是不是一致性缺失，是的话再看是不是伪共享
+  void classify_miss(uint32_t hart, uint32_t pc, uint32_t line, uint64_t bytes) {
+    DirEntry& d = directory[line];
+    auto it = d.lost.find(hart);
+    if (it == d.lost.end()) {
+      caches[hart].stats.misses++;
+      return;
+    }
+    caches[hart].stats.coherence_misses++;
+    if ((it->second.written & bytes) == 0) {
+      caches[hart].stats.false_sharing++;
+      FalseSharing& f = false_sharing[line * config.line_size];
+      f.count++;
+      f.miss_pcs[pc]++;
+      f.writer_pcs[it->second.writer_pc]++;
+    }
+    d.lost.erase(it);
+  }
+
+  static void top_pcs(std::ostream& os, const char* title, const std::map<uint32_t, uint64_t>& pcs) {
+    std::vector<std::pair<uint64_t, uint32_t>> sorted;
+    for (const auto& [pc, n] : pcs) sorted.push_back({n, pc});
+    std::sort(sorted.rbegin(), sorted.rend());
+    os << "    " << title << ":";
+    for (size_t i = 0; i < sorted.size() && i < 4; ++i) {
+      os << " 0x" << std::hex << sorted[i].second << std::dec << " (" << sorted[i].first << ")";
+    }
+    os << "\n";
+  }
+
+ public:
+  CoherenceModel(uint32_t harts, const Cache_Config& c)
+      : config(c), sets(c.ways && c.line_size ? c.size / (c.line_size * c.ways) : 0), caches(harts) {
+    if (sets == 0) throw std::runtime_error("Cache size must be at least ways * line_size");
+    if (harts > 64) throw std::runtime_error("Coherence model supports at most 64 harts");
+    if (c.line_size > 64) throw std::runtime_error("Coherence model supports lines of at most 64 bytes");
+    for (auto& cache : caches) cache.lines.resize(sets * c.ways);
+  }
+
+  // 一次 size 字节的访问；跨行的访问只算第一行
+  void access(uint32_t hart, uint32_t pc, uint32_t addr, uint32_t size, bool is_write) {
+    uint32_t line = addr / config.line_size;
+    uint32_t offset = addr % config.line_size;
+    uint32_t n = std::min(size, config.line_size - offset);
+    uint64_t bytes = (n >= 64 ? ~0ull : ((1ull << n) - 1)) << offset;
+    std::lock_guard<std::mutex> guard(lock);
+    PrivateCache& cache = caches[hart];
+    cache.stats.accesses++;
+    Line* l = find(hart, line);
+    if (l == nullptr) {
+      classify_miss(hart, pc, line, bytes);
+      DirEntry& d = directory[line];
+      if (is_write) {
+        for (uint32_t h = 0; h < caches.size(); ++h) {
+          if (h != hart && (d.sharers >> h & 1)) invalidate(h, line, pc);
+        }
+      } else if (d.owner >= 0 && d.owner != static_cast<int>(hart)) {
+        Line* o = find(d.owner, line);
+        if (o != nullptr) {
+          if (o->state == MESI::M) caches[d.owner].stats.writebacks++;
+          o->state = MESI::S;
+          caches[d.owner].stats.downgrades++;
+        }
+        d.owner = -1;
+      }
+      Line& fresh = allocate(hart, line);
+      DirEntry& e = directory[line];
+      bool alone = e.sharers == 0;
+      e.sharers |= 1ull << hart;
+      fresh.state = is_write ? MESI::M : alone ? MESI::E : MESI::S;
+      if (fresh.state != MESI::S) e.owner = hart;
+      l = &fresh;
+    } else if (is_write && l->state == MESI::S) {
+      cache.stats.upgrades++;
+      DirEntry& d = directory[line];
+      for (uint32_t h = 0; h < caches.size(); ++h) {
+        if (h != hart && (d.sharers >> h & 1)) invalidate(h, line, pc);
+      }
+      l->state = MESI::M;
+      d.owner = hart;
+    } else if (is_write) {
+      l->state = MESI::M;
+    }
+    l->lru = ++cache.stamp;
+    if (is_write) {
+      for (auto& [h, lost] : directory[line].lost) {
+        if (h != hart) lost.written |= bytes;
+      }
+    }
+  }
+
+  // 每个 hart 的计数器和合计，伪共享最多的 top 行及相关 PC
+  void report(std::ostream& os, size_t top = 10) {
+    std::lock_guard<std::mutex> guard(lock);
+    os << "coherence (MESI, " << config.size << " B private L1, " << config.line_size << " B lines)\n";
+    os << std::left << std::setw(6) << "hart" << std::right << std::setw(12) << "accesses" << std::setw(10)
+       << "misses" << std::setw(11) << "coh_miss" << std::setw(10) << "false_sh" << std::setw(10) << "upgrades"
+       << std::setw(8) << "inval" << std::setw(11) << "downgrade" << std::setw(11) << "writeback" << "\n";
+    CoherenceStats total;
+    auto row = [&os](const std::string& name, const CoherenceStats& s) {
+      os << std::left << std::setw(6) << name << std::right << std::setw(12) << s.accesses << std::setw(10)
+         << s.misses << std::setw(11) << s.coherence_misses << std::setw(10) << s.false_sharing << std::setw(10)
+         << s.upgrades << std::setw(8) << s.invalidations << std::setw(11) << s.downgrades << std::setw(11)
+         << s.writebacks << "\n";
+    };
+    for (uint32_t h = 0; h < caches.size(); ++h) {
+      const CoherenceStats& s = caches[h].stats;
+      row(std::to_string(h), s);
+      total.accesses += s.accesses;
+      total.misses += s.misses;
+      total.coherence_misses += s.coherence_misses;
+      total.false_sharing += s.false_sharing;
+      total.upgrades += s.upgrades;
+      total.invalidations += s.invalidations;
+      total.downgrades += s.downgrades;
+      total.writebacks += s.writebacks;
+    }
+    row("all", total);
+
+    std::vector<std::pair<uint64_t, uint32_t>> lines;
+    for (const auto& [addr, f] : false_sharing) lines.push_back({f.count, addr});
+    std::sort(lines.rbegin(), lines.rend());
+    if (lines.empty()) return;
+    os << "false sharing by line:\n";
+    for (size_t i = 0; i < lines.size() && i < top; ++i) {
+      const FalseSharing& f = false_sharing[lines[i].second];
+      os << "  0x" << std::hex << lines[i].second << std::dec << ": " << f.count << " misses\n";
+      top_pcs(os, "missing PCs", f.miss_pcs);
+      top_pcs(os, "invalidating PCs", f.writer_pcs);
+    }
+  }
+};
+
+// 把一个 hart 的 trace 记录转成对一致性模型的访问
+class CoherenceSink : public TraceSink {
+ private:
+  CoherenceModel& model;
+  uint32_t hart;
+
+ public:
+  CoherenceSink(CoherenceModel& m, uint32_t h) : model(m), hart(h) {}
+
+  void record(const TraceRecord& r) override {
+    uint32_t opcode = r.inst & 0x7F;
+    uint32_t f3 = (r.inst >> 12) & 0x7;
+    if (opcode == 0b0000011 || opcode == 0b0100011) {
+      model.access(hart, r.pc, r.mem_addr, 1u << (f3 & 0x3), opcode == 0b0100011);
+    } else if (opcode == 0b0101111) {
+      // lr.w 只读，其余原子操作都是读改写
+      model.access(hart, r.pc, r.mem_addr, 4, (r.inst >> 27) != 0b00010);
+    }
+  }
+};
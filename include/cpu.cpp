@@ -1,7 +1,46 @@
 #include "ReservationStation.cpp"
+#include "predictor.cpp"
+#include "sampler.cpp"
+#include "profile.cpp"
+#include "callstack.cpp"
+#include "trace.cpp"
+#include "checkpoint.cpp"
 #include <iostream>
 #include <iomanip>
+#include <atomic>
+
+// 流水线日志只在以 -DPIPELINE_LOG 编译时存在，否则日志代码完全不参与编译
+#ifdef PIPELINE_LOG
+#include "kanata.cpp"
+#define PIPE_LOG(...) do { if (kanata != nullptr) { __VA_ARGS__; } } while (0)
+#else
+#define PIPE_LOG(...) do {} while (0)
+#endif
+
+const uint32_t HALT_INSTRUCTION = 0x0FF00513;   // li a0, 255
+
+// 乱序核的参数，默认值即原来写死的配置
+struct Core_Config {
+  uint32_t rob_size = 1024;
+  uint32_t rs_size = 1024;
+  uint32_t lsb_size = 1024;
+  uint32_t width = 1;   // 每周期最多发射、执行、提交的指令数；LSB 仍然每周期发一个访存
+  PredictorType predictor = PredictorType::TAKEN;
+};
+
+// 功能模型的体系结构状态，Memory 复制时共享页面，所以保存一份很便宜
+struct ArchState {
+  Memory mem;
+  RegisterFile regs;
+  bool halted;
+};
+
+// 每个周期的发射槽归属（top-down）
+enum class Slot {
+  ISSUED, FRONTEND, BACKEND_MEMORY, BACKEND_CORE, WRONG_PATH
+};
 
+// 较大的成员函数定义在 lib/cpu.cpp，单独编译
 class CPU {
  private:
   Memory mem;
@@ -9,8 +48,81 @@ class CPU {
   ROB rob;
   ReservationStation RS;
   LoadStoreBuffer LSB;
+  ALU alu;
+  Predictor predictor;
+  MemSystem ms;
+  EventQueue events;
+  uint32_t width = 1;
+
+  // 乱序模型的状态
+  uint64_t cycle = 0;
+  uint64_t instret = 0;
+  uint64_t mispredicts = 0;
+  bool halted = false;
+  std::vector<uint64_t> mem_done;
+  std::vector<std::pair<uint32_t, uint32_t>> exec_done;   // 本周期执行完的 (ROB 编号, 结果)
+
+  // top-down 统计：每周期 width 个发射槽
+  uint64_t issued = 0;
+  uint64_t slots_frontend = 0;
+  uint64_t slots_backend_memory = 0;
+  uint64_t slots_backend_core = 0;
+  uint64_t slots_wrong_path = 0;   // 回放时等待预测错误的分支提交
+  bool issue_blocked_by_lsb = false;
+  bool fetch_starved = false;   // 取指没有指令可给，例如回放的 trace 已经取完
+  Slot last_slot = Slot::ISSUED;
+  uint32_t stalled_slots = 0;   // 上个周期没用上的槽数
+  Histogram rob_occupancy;
+  Histogram rs_occupancy;
+  Histogram lsb_occupancy;
+  StatRegistry stats;
+
+  // 区间采样，sampler 为空时不采样
+  IntervalSampler* sampler = nullptr;
+  uint64_t sample_interval = 0;
+  bool sample_by_insts = false;
+  uint64_t next_sample = 0;
+
+  // 按 PC 的执行/周期统计，profiler 为空时不统计
+  Profiler* profiler = nullptr;
+  CallProfiler* callstack = nullptr;
+  TraceSink* tracer = nullptr;
+  std::ostream* output = &std::cout;   // 停机时打印 a0，为空时不打印
+
+  // 多 hart 功能模拟：mhartid 的值和 LR 保留的地址及读到的值
+  uint32_t hart_id = 0;
+  bool reservation_valid = false;
+  uint32_t reservation_addr = 0;
+  uint32_t reservation_value = 0;
+
+  // trace 回放（trace 文件或功能模型线程送来的 oracle 流）：按 trace 取指，结果直接取自 trace，不做功能执行也不写内存。
+  // trace 里没有错误路径上的指令：预测和 trace 的下一条 PC 不同时，有程序镜像的话沿预测路径从镜像取指，
+  // 这些指令照常占用 ROB/RS/LSB、访问 cache，由 ALU 算出地址，分支提交时冲刷；没有镜像时停止取指直到该分支提交。
+  // trace 结束后同样从镜像取指，这样停机指令和 --ooo 一样经过流水线
+  TraceSource* replay = nullptr;
+  TraceRecord replay_cur{};
+  bool replay_valid = false;
+  bool replay_wrong_path = false;
+  bool replay_fetch_wrong_path = false;
+
+#ifdef PIPELINE_LOG
+  KanataWriter* kanata = nullptr;
+  uint64_t pipe_next_id = 0;
+  std::vector<uint64_t> pipe_ids;         // ROB 编号 -> 日志中的指令编号
+  std::vector<uint32_t> pipe_writeback;   // 本周期 ALU 算完的指令，下一周期写回
+
+  void pipe_stage(uint32_t rob_id, PipeStage s) {
+    kanata->stage(cycle, pipe_ids[rob_id], s);
+  }
+#endif
+
+  void register_stats();
+
  public:
-  CPU() = default;
+  CPU();
+  CPU(const Cache_Config& l1, const DRAM_Config& dram, const Core_Config& core = Core_Config());
+  CPU(const CPU&) = delete;
+  CPU& operator=(const CPU&) = delete;
   ~CPU() = default;
 
   void set_PC(uint32_t pos) {
@@ -66,12 +178,12 @@ class CPU {
   }
 
   void lui(uint32_t rd, uint32_t imm) {
-    regs.set(rd, imm << 12);
+    regs.set(rd, imm);
     mem.step_PC();
   }
 
   void auipc(uint32_t rd, uint32_t imm) {
-    regs.set(rd, (imm << 12) + mem.get_PC());
+    regs.set(rd, imm + mem.get_PC());
     mem.step_PC();
   }
 
@@ -122,19 +234,26 @@ class CPU {
     mem.step_PC();
   }
 
+  // 共享内存时对齐的 sh/sw 整体写入，其他 hart 看不到一半新一半旧的值
   void sh(uint32_t rs1, uint32_t rs2, int32_t offset) {
     uint16_t data = static_cast<uint16_t>(regs.read_unsigned(rs2) & 0xFFFF);
-    mem.write_byte(regs.read_unsigned(rs1) + offset, static_cast<uint8_t>(data & 0xFF));
-    mem.write_byte(regs.read_unsigned(rs1) + offset + 1, static_cast<uint8_t>((data >> 8) & 0xFF));
+    mem.write_halfword(regs.read_unsigned(rs1) + offset, data);
     mem.step_PC();
   }
 
   void sw(uint32_t rs1, uint32_t rs2, int32_t offset) {
-    uint32_t data = regs.read_unsigned(rs2);
-    mem.write_byte(regs.read_unsigned(rs1) + offset, static_cast<uint8_t>(data & 0xFF));
-    mem.write_byte(regs.read_unsigned(rs1) + offset + 1, static_cast<uint8_t>((data >> 8) & 0xFF));
-    mem.write_byte(regs.read_unsigned(rs1) + offset + 2, static_cast<uint8_t>((data >> 16) & 0xFF));
-    mem.write_byte(regs.read_unsigned(rs1) + offset + 3, static_cast<uint8_t>((data >> 24) & 0xFF));
+    mem.write_word(regs.read_unsigned(rs1) + offset, regs.read_unsigned(rs2));
+    mem.step_PC();
+  }
+
+  // RV32A，直接用宿主机的原子操作。sc.w 用 CAS 比较 lr.w 读到的值，
+  // 所以中间被改成别的值又改回来时也会成功（ABA），对锁和计数器这类用法没有影响。
+  // 返回写入 rd 的值（rd 为 x0 时也返回），sc.w 成功为 0
+  uint32_t amo(const std::string& op, uint32_t rd, uint32_t rs1, uint32_t rs2);
+
+  // 只实现 mhartid，其余 CSR 读出 0，写入忽略
+  void csr(uint32_t rd, uint32_t number) {
+    regs.set(rd, number == 0xF14 ? hart_id : 0);
     mem.step_PC();
   }
 
@@ -261,10 +380,15 @@ class CPU {
     mem.set_PC(addr);
   }
 
-  uint32_t get_PC() {
+  uint32_t get_PC() const {
     return mem.get_PC();
   }
 
+  // 体系结构上的 PC：乱序模型运行后 mem 里的是取指 PC，最老的未提交指令才是下一条要执行的
+  uint32_t get_committed_PC() const {
+    return rob.is_empty() ? mem.get_PC() : rob.front().pc;
+  }
+
   uint32_t get_instruction() {
     //std::cout << "PC: " << mem.get_PC() << std::endl;
     //std::cout << "instruction: " << mem.read_word(mem.get_PC()) << std::endl;
@@ -275,244 +399,205 @@ class CPU {
     return mem.read_byte(pos);
   }
 
-  void execute(uint32_t instruction) {
-    if (instruction == 0x0FF00513 || mem.get_PC() == 8) {
-      uint32_t res = regs.read_unsigned(10);
-      std::cout << std::dec << (res & 0xFF) << std::endl;
-      exit(0);
-    }
-    Instruction ins(instruction);
-    std::string operation = ins.get_op();
-    //if (instruction != 0) std::cout << "instruction: " << std::bitset<32>(instruction) << std::endl;
-    //std::cout << "pos: " << std::hex << (mem.get_PC()) << std::endl;    
-    //if (instruction != 0) std::cout << "op: " << operation<< std::endl;
-    if (operation == "lb") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      int32_t imm = ins.get_i_imm();
-      lb(rd, rs1, imm);
-    } else if (operation == "lh") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      int32_t imm = ins.get_i_imm();
-      lh(rd, rs1, imm);
-    } else if (operation == "lw") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      int32_t imm = ins.get_imm();
-      lw(rd, rs1, imm);
-    } else if (operation == "lbu") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      int32_t imm = ins.get_imm();
-      lbu(rd, rs1, imm);
-    } else if (operation == "lhu") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      int32_t imm = ins.get_imm();
-      lhu(rd, rs1, imm);
-    } else if (operation == "lui") {
-      uint32_t rd = ins.get_rd();
-      int32_t imm = ins.get_imm();
-      lui(rd, imm);
-    } else if (operation == "auipc") {
-      uint32_t rd = ins.get_rd();
-      int32_t imm = ins.get_imm();
-      auipc(rd, imm);
-    } else if (operation == "jal") {
-      uint32_t rd = ins.get_rd();
-      uint32_t offset = ins.get_jal_imm();
-      jal(rd, static_cast<int32_t>(offset));
-    } else if (operation == "jalr") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      int32_t imm = ins.get_imm();
-      jalr(rd, rs1, imm);
-    } else if (operation == "beq") {
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-      int32_t imm = ins.get_imm();
-      beq(rs1, rs2, imm);
-    } else if (operation == "bne") {
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-      int32_t imm = ins.get_imm();
-      bne(rs1, rs2, imm);
-    } else if (operation == "blt") {
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-      int32_t imm = ins.get_imm();
-      blt(rs1, rs2, imm);
-    } else if (operation == "bge") {
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-      int32_t imm = ins.get_imm();
-      bge(rs1, rs2, imm);
-    } else if (operation == "bltu") {
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-      int32_t imm = ins.get_imm();
-      bltu(rs1, rs2, imm);
-    } else if (operation == "bgeu") {
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-      int32_t imm = ins.get_imm();
-      bgeu(rs1, rs2, imm);
-    } else if (operation == "sb") {
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-      int32_t imm = ins.get_imm();
-      sb(rs1, rs2, imm);
-    } else if (operation == "sh") {
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-      int32_t imm = ins.get_imm();
-      sh(rs1, rs2, imm);
-    } else if (operation == "sw") {
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-      int32_t imm = ins.get_imm();
-      sw(rs1, rs2, imm);
-    } else if (operation == "addi") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      int32_t imm = ins.get_imm();
-      addi(rd, rs1, imm);
-    } else if (operation == "slti") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      int32_t imm = ins.get_imm();
-      slti(rd, rs1, imm);
-    } else if (operation == "sltiu") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      int32_t imm = ins.get_imm();
-      sltiu(rd, rs1, imm);
-    } else if (operation == "xori") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      int32_t imm = ins.get_imm();
-      xori(rd, rs1, imm);
-    } else if (operation == "ori") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      int32_t imm = ins.get_imm();
-      ori(rd, rs1, imm);
-    } else if (operation == "andi") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      int32_t imm = ins.get_imm();
-      andi(rd, rs1, imm);
-    } else if (operation == "slli") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t imm = ins.get_shamt();
-      slli(rd, rs1, imm);
-    } else if (operation == "srli") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t imm = ins.get_shamt();
-      srli(rd, rs1, imm);
-    } else if (operation == "srai") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t imm = ins.get_shamt();
-      srai(rd, rs1, imm);
-    } else if (operation == "add") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-      add_op(rd, rs1, rs2);
-    } else if (operation == "sub") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-      sub_op(rd, rs1, rs2);
-    } else if (operation == "sll") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-      sll_op(rd, rs1, rs2);
-    } else if (operation == "slt") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-      slt_op(rd, rs1, rs2);
-    } else if (operation == "sltu") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-      sltu_op(rd, rs1, rs2);
-    } else if (operation == "xor") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-      cpu_xor(rd, rs1, rs2);
-    } else if (operation == "srl") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-      cpu_srl(rd, rs1, rs2);
-    } else if (operation == "sra") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-      cpu_sra(rd, rs1, rs2);
-    } else if (operation == "or") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-      cpu_or(rd, rs1, rs2);
-    } else if (operation == "and") {
-      uint32_t rd = ins.get_rd();
-      uint32_t rs1 = ins.get_rs1();
-      uint32_t rs2 = ins.get_rs2();
-      cpu_and(rd, rs1, rs2);
-    } else {
-      //std::cout << "invalid instruction" << std::endl;
-    }
-  }
+  void execute(uint32_t instruction);
 
   void cpu_reset() {
     regs.reset();
   }
 
-  void fetch() {
-    uint8_t raw_inst1 = mem.read_byte(mem.get_PC());
-    uint8_t raw_inst2 = mem.read_byte(mem.get_PC() + 1);    
-    uint8_t raw_inst3 = mem.read_byte(mem.get_PC() + 2);
-    uint8_t raw_inst4 = mem.read_byte(mem.get_PC() + 3);
-    uint32_t raw_inst = (raw_inst4 << 24) | (raw_inst3 << 16) | (raw_inst2 << 8) | raw_inst1;
-    Instruction inst = Instruction(raw_inst);
-    rob.set_input(inst);
+  bool is_halted() const {
+    return halted;
   }
 
-  bool is_memory(Instruction& inst) {
-    std::string op = inst.get_op();
-    if (op == "lb" || op == "lh" || op == "lw" || op == "sb" || op == "sw" || op == "sh"
-      || op == "lhu" || op == "lbu") return true;
-    return false;
+  // 功能模式执行至多 max_insts 条指令或到停机为止，返回退休的指令数（停机指令本身不算）
+  uint64_t run_functional(uint64_t max_insts = UINT64_MAX) {
+    uint64_t n = 0;
+    while (n < max_insts && !halted) {
+      cpu_reset();
+      execute(get_instruction());
+      if (!halted) n++;
+    }
+    return n;
   }
 
-  bool issue(Instruction& inst,
-           ROB& rob, RegisterFile& regs,
-           ReservationStation& rs, LoadStoreBuffer& lsb) {
-    std::string op = inst.get_op();
-    uint32_t rs1 = inst.get_rs1(), rs2 = inst.get_rs2(), rd = inst.get_rd(), imm = inst.get_imm();
-    uint32_t raw = inst.code;
+  // 程序的返回值，即停机时 a0 的低 8 位
+  uint32_t get_exit_code() const {
+    return regs.read_unsigned(10) & 0xFF;
+  }
 
-    int rob_id = rob.allocate(raw, rd, is_branch(op), false, false, 0);
-    if (rob_id == -1) return false;
-    if (has_dest(op)) {
-        regs.set_reorder(rd, rob_id);
-    }
+  void set_output(std::ostream* os) {
+    output = os;
+  }
 
-    if (is_memory(inst)) {
-      if (!lsb.insert_inst(inst, regs, rob)) return false;
-    } else {
-      if (!rs.insert_inst(inst, rob, regs)) return false;
-    }
+  // 让核停顿 n 个周期，期间的发射槽都算作等访存；多核模拟用它补上共享 DRAM 争用带来的延迟
+  void stall(uint64_t n);
+
+  void set_dram_log(std::vector<DRAM_Access>* log) {
+    ms.set_dram_log(log);
+  }
+
+  void set_hart_id(uint32_t id) {
+    hart_id = id;
+  }
+
+  // 之后对内存的访问都经过 pages，多个 CPU 共用同一个 pages 即可在不同线程里同时运行功能模型
+  void share_memory(std::shared_ptr<SharedPages> pages) {
+    mem.share(std::move(pages));
+  }
+
+  uint64_t get_cycle() const {
+    return cycle;
+  }
+
+  // 读出寄存器当前值；rs 没有等待中的写入时 Q 为 0，否则 Q 为 ROB 编号 + 1
+  void read_operand(uint32_t r, uint32_t& V, uint32_t& Q);
+
+  void broadcast(uint32_t rob_id, uint32_t value) {
+    RS.update_operand(rob_id, value);
+    LSB.update_operand(rob_id, value);
+  }
+
+  void flush_pipeline(uint32_t correct_pc);
+
+  void halt();
+
+  // 每周期提交 ROB 头部的一条指令，store 在此时写入内存
+  bool commit_stage();
+
+  // 存储层次返回的 load 结果写回，然后 LSB 发出新的访存
+  bool memory_stage();
+
+  // width 个 ALU，每周期最多执行 width 条就绪的指令，结果在周期末广播，
+  // 所以同一周期里不会有指令用上刚算出的值
+  bool execute_stage();
+
+  // 每周期取一条指令，预测下一条 PC，重命名后放入 RS 或 LSB
+  bool issue_stage();
+
+  // 没能发射时判断是被什么挡住：取指没有指令可给算 frontend（取指是理想的，预测错误后下一周期就从正确的 PC 取，
+  // 所以只有回放的 trace 取完时才会出现），LSB 满或 ROB 头部在等访存算 memory，其余算 core
+  Slot classify_stall();
+
+  void set_sampler(IntervalSampler* s, uint64_t interval, bool by_insts) {
+    sampler = s;
+    sample_interval = interval;
+    sample_by_insts = by_insts;
+    next_sample = interval;
+  }
+
+  // fetch_wrong_path 要求 mem 里有程序镜像
+  void set_replay(TraceSource* r, bool fetch_wrong_path = false) {
+    replay = r;
+    replay_fetch_wrong_path = fetch_wrong_path;
+    replay_valid = replay->next(replay_cur);
+    if (replay_valid) mem.set_PC(replay_cur.pc);
+  }
+
+#ifdef PIPELINE_LOG
+  void set_pipeline_log(KanataWriter* k) {
+    kanata = k;
+    pipe_ids.assign(rob.get_capacity(), 0);
+  }
+#endif
+
+  void set_profiler(Profiler* p) {
+    profiler = p;
+  }
+
+  void set_tracer(TraceSink* t) {
+    tracer = t;
+  }
+
+  void set_call_profiler(CallProfiler* c) {
+    callstack = c;
+  }
+
+  void write_profile(std::ostream& os, const SymbolTable* syms) const {
+    if (profiler != nullptr) profiler->report(os, mem, syms);
+  }
+
+  Sample snapshot(uint64_t at_cycle) const {
+    return {at_cycle, instret, mispredicts, ms.get_l1().get_accesses(), ms.get_l1().get_misses(),
+            rob.get_size(), LSB.get_size()};
+  }
+
+  void maybe_sample() {
+    uint64_t now = sample_by_insts ? instret : cycle;
+    if (now < next_sample) return;
+    sampler->record(snapshot(cycle));
+    next_sample += sample_interval;
+  }
+
+  // 把 weight 个周期里没用上的槽记到 last_slot 上，同时记录队列占用
+  void account(uint64_t weight);
+
+  // 乱序模型前进一个周期，返回这个周期内是否有状态变化
+  bool tick();
+
+  // 运行到停机、提交了 max_insts 条指令或到达周期 until。某个周期没有任何变化时，之后的周期也不会有变化，
+  // 直到下一个事件到来，因此直接把时钟拨到该事件，结果与逐周期运行完全一致
+  void run(bool skip_idle = true, uint64_t max_insts = UINT64_MAX, uint64_t until = UINT64_MAX);
 
-    return true;
+  // 从乱序模型切回功能模型：丢弃未提交的指令，PC 回到最老的未提交指令，
+  // 再等存储层次里已发出的请求全部完成
+  void leave_detailed();
+
+  // 功能预热时访问一次 L1
+  void warm_memory(uint32_t addr, bool is_write) {
+    ms.warm(addr, is_write);
+  }
+
+  // 功能预热时训练一次分支预测器
+  void warm_branch(uint32_t pc, bool taken) {
+    predictor.update(pc, taken);
+  }
+
+  // parent 非空时保存相对于它的增量 checkpoint；之后的脏页从这里重新记起
+  void save_checkpoint(const std::string& path, uint64_t instructions, const std::string& parent = "") {
+    ::save_checkpoint(path, mem, regs, instructions, parent);
+    mem.clear_dirty();
+  }
+
+  uint64_t restore_checkpoint(const std::string& path) {
+    return ::restore_checkpoint(path, mem, regs);
+  }
+
+  ArchState save_state() const {
+    return {mem, regs, halted};
+  }
+
+  void load_state(const ArchState& s) {
+    mem = s.mem;
+    regs = s.regs;
+    halted = s.halted;
+  }
+
+  uint32_t get_register(uint32_t i) const {
+    return regs.read_unsigned(i);
+  }
+
+  uint32_t read_memory_word(uint32_t addr) const {
+    return mem.read_word(addr);
+  }
+
+  uint64_t get_instret() const {
+    return instret;
+  }
+
+  void print_stats(std::ostream& os) const;
+
+  const StatRegistry& get_stats() const {
+    return stats;
+  }
+
+  void dump_stats_json(std::ostream& os) const {
+    stats.dump_json(os);
+  }
+
+  bool is_memory(Instruction& inst) {
+    std::string op = inst.get_op();
+    if (op == "lb" || op == "lh" || op == "lw" || op == "sb" || op == "sw" || op == "sh"
+      || op == "lhu" || op == "lbu") return true;
+    return false;
   }
-};
\ No newline at end of file
+};
@@ -0,0 +1,67 @@
+#ifndef CPUSIM_H
+#define CPUSIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* libcpusim 的 C 接口。模拟器实例互相独立，可以在不同线程里各用各的；
+ * 同一个实例不能同时在多个线程里调用。出错的函数返回 CPUSIM_ERROR 或 NULL，
+ * 原因用 cpusim_last_error 取 */
+
+#if defined(_WIN32)
+#define CPUSIM_API __declspec(dllexport)
+#else
+#define CPUSIM_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct cpusim cpusim_t;
+
+enum cpusim_status {
+  CPUSIM_ERROR = -1,
+  CPUSIM_HALTED = 0,   /* 程序执行了停机指令 */
+  CPUSIM_LIMIT = 1     /* 达到指令数上限，可以继续运行 */
+};
+
+enum cpusim_mode {
+  CPUSIM_FUNCTIONAL = 0,
+  CPUSIM_OOO = 1
+};
+
+CPUSIM_API const char* cpusim_version(void);
+
+/* options 是与命令行相同的配置选项，例如 "--rob-size=64"、"--l1-size=16384"，可以为 NULL */
+CPUSIM_API cpusim_t* cpusim_create(const char* const* options, int count);
+CPUSIM_API void cpusim_destroy(cpusim_t* sim);
+CPUSIM_API const char* cpusim_last_error(const cpusim_t* sim);
+
+/* 载入 "@地址" 加十六进制字节格式的镜像，PC 置为 0；成功返回 0 */
+CPUSIM_API int cpusim_load_image(cpusim_t* sim, const char* text, size_t length);
+CPUSIM_API int cpusim_load_image_file(cpusim_t* sim, const char* path);
+
+/* 运行到停机或再提交 max_insts 条指令（UINT64_MAX 为不限），两种模式可以交替使用 */
+CPUSIM_API int cpusim_run(cpusim_t* sim, int mode, uint64_t max_insts);
+
+CPUSIM_API int cpusim_is_halted(const cpusim_t* sim);
+CPUSIM_API uint32_t cpusim_exit_code(const cpusim_t* sim);
+CPUSIM_API uint32_t cpusim_get_pc(const cpusim_t* sim);
+CPUSIM_API uint32_t cpusim_get_reg(const cpusim_t* sim, unsigned index);
+CPUSIM_API uint32_t cpusim_read_word(const cpusim_t* sim, uint32_t addr);
+CPUSIM_API void cpusim_write_word(cpusim_t* sim, uint32_t addr, uint32_t value);
+
+/* 已执行的指令数，两种模式合计 */
+CPUSIM_API uint64_t cpusim_instructions(const cpusim_t* sim);
+
+/* 乱序模型的计数器，名字与 --stats-json 相同，例如 "cycles"、"l1d.misses"；成功返回 0，没有这个计数器时返回 CPUSIM_ERROR */
+CPUSIM_API int cpusim_get_counter(const cpusim_t* sim, const char* name, uint64_t* value);
+CPUSIM_API int cpusim_counter_count(const cpusim_t* sim);
+CPUSIM_API const char* cpusim_counter_name(const cpusim_t* sim, int index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,303 @@
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <ostream>
+#include <stdexcept>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// 常驻模式：在 Unix 域套接字上接收文本命令，每行一条，结果按行写回，例如用 nc -U 连接：
+//   load <名字> <镜像路径>           解析镜像并留在内存里          -> loaded <名字>
+//   run <名字> <ooo|functional> [--max-insts=N] [配置选项...]   -> queued <任务号>，完成后 done <任务号> ...
+//   drop <名字> / status / shutdown
+// 镜像解析一次后以 ArchState 保存，任务开始时复制过去，页面写时复制，所以不同任务互不影响
+
+class SimDaemon {
+ private:
+  // 复制 Memory 会改动源对象的页缓存，所以复制镜像要加锁
+  struct Image {
+    std::mutex lock;
+    ArchState state;
+  };
+
+  struct Client {
+    int fd;
+    std::mutex write_lock;
+    std::atomic<bool> closed{false};   // serve 已经返回，线程可以 join
+
+    Client(int f) : fd(f) {}
+    ~Client() { ::close(fd); }
+
+    // 客户端断开后写失败，直接丢掉
+    void send(const std::string& line) {
+      std::lock_guard<std::mutex> guard(write_lock);
+      std::string s = line + "\n";
+      size_t written = 0;
+      while (written < s.size()) {
+        ssize_t n = ::send(fd, s.data() + written, s.size() - written, MSG_NOSIGNAL);
+        if (n <= 0) return;
+        written += n;
+      }
+    }
+  };
+
+  struct Job {
+    uint64_t id;
+    std::shared_ptr<Image> image;
+    bool ooo;
+    uint64_t max_insts;
+    Cache_Config l1;
+    DRAM_Config dram;
+    Core_Config core;
+    std::shared_ptr<Client> client;
+  };
+
+  std::string path;
+  int listen_fd = -1;
+  Cache_Config l1;
+  DRAM_Config dram;
+  Core_Config core;
+  bool skip_idle;
+
+  std::mutex images_lock;
+  std::map<std::string, std::shared_ptr<Image>> images;
+
+  std::mutex queue_lock;
+  std::condition_variable queue_cv;
+  std::deque<Job> queue;
+  bool stopping = false;
+  uint64_t next_job = 1;
+  std::atomic<uint64_t> running{0};
+  std::atomic<uint64_t> completed{0};
+
+  // 连接线程只在 run() 里创建和 join，所以不用加锁
+  std::vector<std::pair<std::shared_ptr<Client>, std::thread>> connections;
+
+  void execute(const Job& job) {
+    auto start = std::chrono::steady_clock::now();
+    std::ostringstream os;
+    try {
+      CPU cpu(job.l1, job.dram, job.core);
+      cpu.set_output(nullptr);
+      {
+        std::lock_guard<std::mutex> guard(job.image->lock);
+        cpu.load_state(job.image->state);
+      }
+      uint64_t executed = 0;
+      if (job.ooo) {
+        cpu.run(skip_idle, job.max_insts);
+      } else {
+        executed = cpu.run_functional(job.max_insts);
+      }
+      os << "done " << job.id << " ";
+      if (cpu.is_halted()) {
+        os << "halted " << cpu.get_exit_code();
+      } else {
+        os << "limit -";
+      }
+      if (job.ooo) {
+        for (const auto& [name, value] : cpu.get_stats().get_counters()) os << " " << name << "=" << *value;
+      } else {
+        os << " instructions=" << executed;
+      }
+      os << " seconds=" << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } catch (const std::exception& e) {
+      os.str("");
+      os << "error " << job.id << " " << e.what();
+    }
+    job.client->send(os.str());
+  }
+
+  void worker() {
+    while (true) {
+      Job job;
+      {
+        std::unique_lock<std::mutex> guard(queue_lock);
+        queue_cv.wait(guard, [this] { return stopping || !queue.empty(); });
+        if (queue.empty()) return;
+        job = std::move(queue.front());
+        queue.pop_front();
+      }
+      running++;
+      execute(job);
+      running--;
+      completed++;
+    }
+  }
+
+  std::string load(const std::string& name, const std::string& file) {
+    std::ifstream in(file);
+    if (!in) return "error cannot open " + file;
+    auto image = std::make_shared<Image>();
+    CPU cpu;
+    uint32_t lo, hi;
+    load_image(cpu, in, lo, hi);
+    cpu.cpu_set_PC(0x0);
+    image->state = cpu.save_state();
+    std::lock_guard<std::mutex> guard(images_lock);
+    images[name] = image;
+    return "loaded " + name;
+  }
+
+  std::string submit(std::istringstream& args, const std::shared_ptr<Client>& client) {
+    std::string name, mode, arg;
+    args >> name >> mode;
+    if (mode != "ooo" && mode != "functional") return "error mode must be ooo or functional";
+    Job job{0, nullptr, mode == "ooo", UINT64_MAX, l1, dram, core, client};
+    {
+      std::lock_guard<std::mutex> guard(images_lock);
+      auto it = images.find(name);
+      if (it == images.end()) return "error no image " + name;
+      job.image = it->second;
+    }
+    while (args >> arg) {
+      std::string value;
+      if (parse_option(arg.c_str(), "--max-insts", value)) {
+        job.max_insts = std::stoull(value);
+      } else if (!parse_config_option(arg.c_str(), job.l1, job.dram, job.core)) {
+        return "error unknown option " + arg;
+      }
+    }
+    std::lock_guard<std::mutex> guard(queue_lock);
+    if (stopping) return "error shutting down";
+    job.id = next_job++;
+    std::string reply = "queued " + std::to_string(job.id);
+    queue.push_back(std::move(job));
+    queue_cv.notify_one();
+    return reply;
+  }
+
+  std::string handle(const std::string& line, const std::shared_ptr<Client>& client) {
+    std::istringstream args(line);
+    std::string cmd;
+    args >> cmd;
+    if (cmd == "load") {
+      std::string name, file;
+      if (!(args >> name >> file)) return "error usage: load <name> <path>";
+      return load(name, file);
+    }
+    if (cmd == "run") return submit(args, client);
+    if (cmd == "drop") {
+      std::string name;
+      args >> name;
+      std::lock_guard<std::mutex> guard(images_lock);
+      return images.erase(name) ? "dropped " + name : "error no image " + name;
+    }
+    if (cmd == "status") {
+      std::ostringstream os;
+      {
+        std::lock_guard<std::mutex> guard(images_lock);
+        os << "status images=" << images.size();
+      }
+      std::lock_guard<std::mutex> guard(queue_lock);
+      os << " queued=" << queue.size() << " running=" << running << " completed=" << completed;
+      return os.str();
+    }
+    if (cmd == "shutdown") {
+      {
+        std::lock_guard<std::mutex> guard(queue_lock);
+        stopping = true;
+      }
+      queue_cv.notify_all();
+      ::shutdown(listen_fd, SHUT_RDWR);
+      return "bye";
+    }
+    return "error unknown command " + cmd;
+  }
+
+  void serve(std::shared_ptr<Client> client) {
+    std::string buffer;
+    char chunk[4096];
+    ssize_t n;
+    while ((n = ::read(client->fd, chunk, sizeof(chunk))) > 0) {
+      buffer.append(chunk, n);
+      size_t eol;
+      while ((eol = buffer.find('\n')) != std::string::npos) {
+        std::string line = buffer.substr(0, eol);
+        buffer.erase(0, eol + 1);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        std::string reply;
+        try {
+          reply = handle(line, client);
+        } catch (const std::exception& e) {
+          reply = std::string("error ") + e.what();
+        }
+        client->send(reply);
+      }
+    }
+    client->closed = true;
+  }
+
+  // join 已经断开的连接的线程，stop 时先关掉所有连接的读端让 serve 返回
+  void reap_connections(bool stop) {
+    for (auto it = connections.begin(); it != connections.end();) {
+      if (stop) ::shutdown(it->first->fd, SHUT_RD);
+      if (stop || it->first->closed) {
+        it->second.join();
+        it = connections.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+ public:
+  SimDaemon(const std::string& socket_path, const Cache_Config& l, const DRAM_Config& d, const Core_Config& c,
+            bool skip)
+      : path(socket_path), l1(l), dram(d), core(c), skip_idle(skip) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) throw std::runtime_error("Socket path too long: " + path);
+    std::strcpy(addr.sun_path, path.c_str());
+    listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) throw std::runtime_error("socket failed");
+    ::unlink(path.c_str());
+    if (::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(listen_fd, 64) != 0) {
+      ::close(listen_fd);
+      throw std::runtime_error("Cannot listen on " + path);
+    }
+  }
+
+  ~SimDaemon() {
+    ::close(listen_fd);
+    ::unlink(path.c_str());
+  }
+
+  SimDaemon(const SimDaemon&) = delete;
+  SimDaemon& operator=(const SimDaemon&) = delete;
+
+  // 每个连接一个线程读命令，任务由 workers 个线程执行；收到 shutdown 后做完排队的任务、
+  // 等所有连接线程退出再返回。连接只关读端，排队任务的结果仍然能写回
+  void run(unsigned workers, std::ostream& log) {
+    log << "listening on " << path << " with " << workers << " workers" << std::endl;
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < workers; ++i) pool.emplace_back(&SimDaemon::worker, this);
+    while (true) {
+      int fd = ::accept(listen_fd, nullptr, nullptr);
+      if (fd < 0) {
+        std::lock_guard<std::mutex> guard(queue_lock);
+        if (stopping) break;
+        continue;
+      }
+      reap_connections(false);
+      auto client = std::make_shared<Client>(fd);
+      connections.emplace_back(client, std::thread(&SimDaemon::serve, this, client));
+    }
+    reap_connections(true);
+    for (auto& t : pool) t.join();
+    log << completed << " jobs completed" << std::endl;
+  }
+};
@@ -0,0 +1,170 @@
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+
+// 数据流极限分析：只保留寄存器和内存（store -> load，按字对齐）的真相关，
+// 取指带宽无限，每条指令的延迟固定。窗口为 W 时，第 i 条指令要等第 i - W 条
+// 按序退出后才能进入窗口，这对应 ROB 容量为 W 的理想乱序核。
+// 关键路径长度逐条累计，只需要每个寄存器和字地址的就绪时间；回溯关键路径用的前驱只保留最近 history 条，
+// 所以统计的是关键路径落在最后 history 条指令里的那一段，内存不随 trace 长度增长
+class DataflowAnalyzer {
+ private:
+  static constexpr uint64_t NONE = UINT64_MAX;
+
+  // 一种窗口大小下的状态
+  struct Window {
+    uint32_t size;
+    std::vector<uint64_t> retire;   // 最近 size 条指令的退出时间，环形
+    uint64_t reg_ready[32] = {};
+    std::unordered_map<uint32_t, uint64_t> mem_ready;
+    uint64_t last_retire = 0;
+  };
+
+  uint32_t load_latency;
+  std::vector<Window> windows;
+  uint64_t count = 0;
+
+  // 窗口无限时的数据流图，用来回溯关键路径
+  uint64_t reg_ready[32] = {};
+  uint64_t reg_producer[32];
+  std::unordered_map<uint32_t, std::pair<uint64_t, uint64_t>> mem_ready;   // 字地址 -> (就绪时间, 生产者)
+  uint64_t history;
+  std::vector<uint64_t> pred;     // 最近 history 条指令各自最晚到达的那个源操作数的生产者，环形
+  std::vector<uint32_t> pcs;
+  std::unordered_map<uint32_t, uint32_t> code_of;   // 静态指令 -> 编码，反汇编用
+  uint64_t critical_length = 0;
+  uint64_t critical_tail = NONE;
+
+  uint32_t latency(uint32_t code) const {
+    return (code & 0x7F) == 0b0000011 ? load_latency : 1;
+  }
+
+ public:
+  DataflowAnalyzer(const std::vector<uint32_t>& sizes, uint32_t load_lat = 1, uint64_t hist = 1 << 20)
+      : load_latency(load_lat), history(hist), pred(hist, NONE), pcs(hist, 0) {
+    if (hist == 0) throw std::runtime_error("History must hold at least one instruction");
+    for (uint32_t s : sizes) {
+      if (s == 0) throw std::runtime_error("Window size must be at least 1");
+      Window w;
+      w.size = s;
+      w.retire.assign(s, 0);
+      windows.push_back(std::move(w));
+    }
+    std::fill(std::begin(reg_producer), std::end(reg_producer), NONE);
+  }
+
+  void add(const TraceRecord& r) {
+    Instruction ins(r.inst);
+    std::string op = ins.get_op();
+    uint32_t srcs[2] = {0, 0};
+    if (has_rs1(op)) srcs[0] = ins.get_rs1();
+    if (has_rs2(op)) srcs[1] = ins.get_rs2();
+    uint32_t opcode = r.inst & 0x7F;
+    bool load = opcode == 0b0000011, store = opcode == 0b0100011;
+    uint32_t word = r.mem_addr >> 2;
+    uint32_t dest = trace_writes_rd(r.inst) ? ins.get_rd() : 0;
+    uint32_t lat = latency(r.inst);
+
+    uint64_t start = 0;
+    uint64_t from = NONE;
+    for (uint32_t s : srcs) {
+      if (s != 0 && reg_ready[s] > start) {
+        start = reg_ready[s];
+        from = reg_producer[s];
+      }
+    }
+    if (load) {
+      auto it = mem_ready.find(word);
+      if (it != mem_ready.end() && it->second.first > start) {
+        start = it->second.first;
+        from = it->second.second;
+      }
+    }
+    uint64_t done = start + lat;
+    uint64_t self = count;
+    if (dest != 0) {
+      reg_ready[dest] = done;
+      reg_producer[dest] = self;
+    }
+    if (store) mem_ready[word] = {done, self};
+    pred[self % history] = from;
+    pcs[self % history] = r.pc;
+    code_of.emplace(r.pc, r.inst);
+    if (done > critical_length) {
+      critical_length = done;
+      critical_tail = self;
+    }
+
+    for (auto& w : windows) {
+      uint64_t& slot = w.retire[count % w.size];
+      uint64_t t = slot;   // 第 count - size 条指令的退出时间
+      for (uint32_t s : srcs) {
+        if (s != 0) t = std::max(t, w.reg_ready[s]);
+      }
+      if (load) {
+        auto it = w.mem_ready.find(word);
+        if (it != w.mem_ready.end()) t = std::max(t, it->second);
+      }
+      t += lat;
+      if (dest != 0) w.reg_ready[dest] = t;
+      if (store) w.mem_ready[word] = t;
+      w.last_retire = std::max(w.last_retire, t);
+      slot = w.last_retire;
+    }
+    count++;
+  }
+
+  void report(std::ostream& os, const SymbolTable* syms, size_t top = 20) const {
+    os << std::fixed << std::setprecision(3);
+    os << "instructions " << count << "\n"
+       << "critical_path " << critical_length << "\n"
+       << "dataflow_ipc " << (critical_length ? static_cast<double>(count) / critical_length : 0.0) << "\n"
+       << "\n# ideal ipc by window size\nwindow      cycles      ipc\n";
+    for (const auto& w : windows) {
+      os << std::setw(6) << w.size << "  " << std::setw(10) << w.last_retire << "  " << std::setw(7)
+         << (w.last_retire ? static_cast<double>(count) / w.last_retire : 0.0) << "\n";
+    }
+
+    // 沿最长的依赖链回溯，统计链上各条静态指令出现的次数，前驱超出保留的范围时停下
+    std::unordered_map<uint32_t, uint64_t> on_path;
+    uint64_t length = 0;
+    for (uint64_t i = critical_tail; i != NONE && count - i <= history; i = pred[i % history]) {
+      on_path[pcs[i % history]]++;
+      length++;
+    }
+    std::vector<std::pair<uint32_t, uint64_t>> order(on_path.begin(), on_path.end());
+    std::sort(order.begin(), order.end(), [](const auto& a, const auto& b) {
+      if (a.second != b.second) return a.second > b.second;
+      return a.first < b.first;
+    });
+    os << "\n# most frequent instructions on the critical path (" << length << " instructions"
+       << (count > history ? " within the last " + std::to_string(history) + " executed" : std::string()) << ")\n"
+       << "pc               count       %   symbol                disassembly\n";
+    for (size_t n = 0; n < order.size() && n < top; ++n) {
+      uint32_t pc = order[n].first;
+      char hex[16];
+      std::snprintf(hex, sizeof(hex), "0x%08x", pc);
+      os << hex << "  " << std::setw(10) << order[n].second << "  " << std::setw(6)
+         << 100.0 * order[n].second / length << "%   " << std::left << std::setw(20)
+         << (syms ? syms->describe(pc) : "") << std::right << "  " << disassemble(code_of.at(pc), pc) << "\n";
+    }
+    os.unsetf(std::ios::fixed);
+  }
+};
+
+// 把功能模型提交的指令直接交给分析器
+class DataflowSink : public TraceSink {
+ private:
+  DataflowAnalyzer& analyzer;
+
+ public:
+  DataflowSink(DataflowAnalyzer& a) : analyzer(a) {}
+  void record(const TraceRecord& r) override {
+    analyzer.add(r);
+  }
+};
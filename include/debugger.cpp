@@ -0,0 +1,183 @@
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <set>
+#include <string>
+#include <sstream>
+#include <istream>
+#include <ostream>
+
+// 反向调试：功能模型每执行 interval 条指令保存一次状态快照（页面写时复制），
+// 快照太多时隔一个删一个并把间隔加倍。后退时恢复最近的快照再确定性地向前重放
+class ReverseDebugger {
+ private:
+  // 重放时记下最后一次写到 addr 的指令序号
+  class WriteWatch : public TraceSink {
+   public:
+    uint32_t addr = 0;
+    const uint64_t* pos = nullptr;
+    uint64_t found = UINT64_MAX;
+
+    // store 按 funct3 定大小；AMO 和成功的 sc.w（rd_value 为 0）写一个字，lr.w 不写内存
+    void record(const TraceRecord& r) override {
+      uint32_t opcode = r.inst & 0x7F;
+      uint32_t size;
+      if (opcode == 0b0100011) {
+        size = 1u << ((r.inst >> 12) & 0x3);
+      } else if (opcode == 0b0101111) {
+        uint32_t funct5 = r.inst >> 27;
+        if (funct5 == 0b00010 || (funct5 == 0b00011 && r.rd_value != 0)) return;
+        size = 4;
+      } else {
+        return;
+      }
+      if (addr - r.mem_addr < size) found = *pos;
+    }
+  };
+
+  CPU& cpu;
+  std::ostream& os;
+  uint64_t pos = 0;   // 已执行的指令数
+  uint64_t interval;
+  size_t max_snapshots;
+  std::vector<std::pair<uint64_t, ArchState>> snapshots;
+  std::set<uint32_t> breakpoints;
+
+  void take_snapshot() {
+    if (!snapshots.empty() && snapshots.back().first >= pos) return;
+    snapshots.push_back({pos, cpu.save_state()});
+    if (snapshots.size() <= max_snapshots) return;
+    interval *= 2;
+    std::vector<std::pair<uint64_t, ArchState>> kept;
+    for (auto& s : snapshots) {
+      if (s.first % interval == 0) kept.push_back(std::move(s));
+    }
+    snapshots = std::move(kept);
+  }
+
+  bool step() {
+    if (cpu.run_functional(1) == 0) return false;
+    pos++;
+    if (pos % interval == 0) take_snapshot();
+    return true;
+  }
+
+  // 回到第 target 条指令执行之前
+  void goto_position(uint64_t target) {
+    size_t i = snapshots.size();
+    while (i > 0 && snapshots[i - 1].first > target) --i;
+    cpu.load_state(snapshots[i - 1].second);
+    pos = snapshots[i - 1].first;
+    while (pos < target && step()) {}
+  }
+
+  // 从当前位置往回找最后一次写 addr 的 store，找到后停在它执行之前
+  bool last_write(uint32_t addr) {
+    uint64_t origin = pos, end = pos;
+    WriteWatch watch;
+    watch.addr = addr;
+    watch.pos = &pos;
+    for (size_t i = snapshots.size(); i > 0; --i) {
+      uint64_t start = snapshots[i - 1].first;
+      if (start >= end) continue;
+      cpu.load_state(snapshots[i - 1].second);
+      pos = start;
+      cpu.set_tracer(&watch);
+      while (pos < end && step()) {}
+      cpu.set_tracer(nullptr);
+      if (watch.found != UINT64_MAX) {
+        goto_position(watch.found);
+        return true;
+      }
+      end = start;
+    }
+    goto_position(origin);
+    return false;
+  }
+
+  void where() {
+    uint32_t pc = cpu.get_PC();
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "0x%08x", pc);
+    os << "#" << pos << " " << buf << ": " << disassemble(cpu.read_memory_word(pc), pc)
+       << (cpu.is_halted() ? " (halted)" : "") << "\n";
+  }
+
+  static uint32_t parse_addr(const std::string& s) {
+    return static_cast<uint32_t>(std::stoul(s, nullptr, 0));
+  }
+
+ public:
+  ReverseDebugger(CPU& c, std::ostream& out, uint64_t every = 100000, size_t max_snaps = 64)
+      : cpu(c), os(out), interval(every ? every : 1), max_snapshots(max_snaps < 2 ? 2 : max_snaps) {
+    take_snapshot();
+  }
+
+  // 命令：step [N] / back [N] / goto N / continue / last-write ADDR / break ADDR / delete ADDR /
+  //       regs / x ADDR [N] / info / quit
+  void run(std::istream& in) {
+    std::string line;
+    where();
+    while (std::getline(in, line)) {
+      std::istringstream ss(line);
+      std::string cmd, arg1, arg2;
+      ss >> cmd >> arg1 >> arg2;
+      if (cmd.empty()) continue;
+      try {
+        if (cmd == "step" || cmd == "s") {
+          uint64_t n = arg1.empty() ? 1 : std::stoull(arg1);
+          for (uint64_t i = 0; i < n && step(); ++i) {}
+          where();
+        } else if (cmd == "back" || cmd == "b") {
+          uint64_t n = arg1.empty() ? 1 : std::stoull(arg1);
+          goto_position(n > pos ? 0 : pos - n);
+          where();
+        } else if (cmd == "goto") {
+          uint64_t target = std::stoull(arg1);
+          if (target < pos) {
+            goto_position(target);
+          } else {
+            while (pos < target && step()) {}
+          }
+          where();
+        } else if (cmd == "continue" || cmd == "c") {
+          while (step() && breakpoints.count(cpu.get_PC()) == 0) {}
+          where();
+        } else if (cmd == "last-write") {
+          uint32_t addr = parse_addr(arg1);
+          if (!last_write(addr)) os << "no earlier write to " << arg1 << "\n";
+          where();
+        } else if (cmd == "break") {
+          breakpoints.insert(parse_addr(arg1));
+        } else if (cmd == "delete") {
+          breakpoints.erase(parse_addr(arg1));
+        } else if (cmd == "regs") {
+          for (uint32_t i = 0; i < 32; ++i) {
+            char buf[32];
+            std::snprintf(buf, sizeof(buf), "x%-2u 0x%08x%s", i, cpu.get_register(i), i % 4 == 3 ? "\n" : "  ");
+            os << buf;
+          }
+        } else if (cmd == "x") {
+          uint32_t addr = parse_addr(arg1);
+          uint32_t n = arg2.empty() ? 1 : std::stoul(arg2);
+          for (uint32_t i = 0; i < n; ++i) {
+            char buf[32];
+            std::snprintf(buf, sizeof(buf), "0x%08x: 0x%08x\n", addr + 4 * i, cpu.read_memory_word(addr + 4 * i));
+            os << buf;
+          }
+        } else if (cmd == "info") {
+          os << "position " << pos << ", " << snapshots.size() << " snapshots every " << interval
+             << " instructions\n";
+          where();
+        } else if (cmd == "quit" || cmd == "q") {
+          break;
+        } else {
+          os << "unknown command: " << cmd << "\n";
+        }
+      } catch (const std::exception& e) {
+        os << "bad argument: " << line << "\n";
+      }
+      os.flush();
+    }
+  }
+};
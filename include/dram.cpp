@@ -0,0 +1,231 @@
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+#include "event.cpp"
+#include "stats.cpp"
+
+// 主存时序模型：channel / bank / row buffer，FR-FCFS 调度
+// 只负责时间，数据仍然由 Memory 保存
+
+struct DRAM_Config {
+  uint32_t channels = 1;
+  uint32_t banks = 8;
+  uint32_t row_size = 2048;       // 每个 row 的字节数
+  uint32_t line_size = 64;        // 每次请求传输的字节数
+  uint32_t t_row_hit = 14;        // CAS
+  uint32_t t_row_miss = 28;       // RCD + CAS（bank 当前没有打开的 row）
+  uint32_t t_row_conflict = 42;   // RP + RCD + CAS（需要先关闭另一个 row）
+  uint32_t t_burst = 4;           // 数据总线占用周期
+  uint32_t queue_size = 32;       // 每个 channel 的请求队列长度
+  bool open_page = true;          // false 为 closed-page：每次访问后立即关闭 row
+};
+
+struct DRAM_Request {
+  uint64_t id;
+  uint32_t addr;
+  bool is_write;
+  uint64_t arrival;
+  uint32_t bank;
+  uint32_t row;
+};
+
+struct DRAM_Bank {
+  int64_t open_row = -1;
+  uint64_t ready_at = 0;   // bank 可以接受下一条命令的周期
+};
+
+struct DRAM_Channel {
+  std::deque<DRAM_Request> queue;
+  std::vector<DRAM_Bank> banks;
+  uint64_t bus_free_at = 0;
+};
+
+// 已调度请求的记录，多核模拟在 quantum 边界上用它重新计算共享 DRAM 上的争用
+struct DRAM_Access {
+  uint32_t addr;
+  bool is_write;
+  uint64_t arrival;
+  uint64_t done_at;
+};
+
+struct DRAM_InFlight {
+  uint64_t id;
+  bool is_write;
+  uint64_t done_at;
+};
+
+class DRAM {
+ private:
+  DRAM_Config config;
+  std::vector<DRAM_Channel> channels;
+  std::vector<DRAM_InFlight> in_flight;
+  EventQueue* events = nullptr;
+  std::vector<DRAM_Access>* log = nullptr;
+
+  uint64_t reads = 0;
+  uint64_t writes = 0;
+  uint64_t row_hits = 0;
+  uint64_t row_misses = 0;
+  uint64_t row_conflicts = 0;
+  uint64_t total_latency = 0;   // 到达到完成的周期和
+  uint64_t bus_busy = 0;        // 所有 channel 数据总线忙碌周期和
+
+  void map(uint32_t addr, uint32_t& channel, uint32_t& bank, uint32_t& row) const {
+    uint32_t line = addr / config.line_size;
+    channel = line % config.channels;
+    line /= config.channels;
+    line /= (config.row_size / config.line_size);
+    bank = line % config.banks;
+    row = line / config.banks;
+  }
+
+  // FR-FCFS：先找最早的 row hit，没有的话选最早的可以服务的请求
+  int pick(DRAM_Channel& ch, uint64_t now) const {
+    int first_ready = -1;
+    for (size_t i = 0; i < ch.queue.size(); ++i) {
+      const DRAM_Request& r = ch.queue[i];
+      const DRAM_Bank& b = ch.banks[r.bank];
+      if (b.ready_at > now) continue;
+      if (b.open_row == static_cast<int64_t>(r.row)) return static_cast<int>(i);
+      if (first_ready == -1) first_ready = static_cast<int>(i);
+    }
+    return first_ready;
+  }
+
+ public:
+  DRAM() : DRAM(DRAM_Config()) {}
+  DRAM(const DRAM_Config& c) : config(c), channels(c.channels) {
+    if (c.channels == 0 || c.banks == 0 || c.queue_size == 0) {
+      throw std::runtime_error("DRAM channels, banks and queue size must be at least 1");
+    }
+    for (auto& ch : channels) {
+      ch.banks.resize(config.banks);
+    }
+  }
+
+  const DRAM_Config& get_config() const { return config; }
+
+  void set_events(EventQueue* e) { events = e; }
+
+  // 之后每个发出的请求都追加到 l，为空时不记录
+  void set_log(std::vector<DRAM_Access>* l) { log = l; }
+
+  bool can_accept(uint32_t addr) const {
+    uint32_t channel, bank, row;
+    map(addr, channel, bank, row);
+    return channels[channel].queue.size() < config.queue_size;
+  }
+
+  bool enqueue(uint64_t id, uint32_t addr, bool is_write, uint64_t now) {
+    uint32_t channel, bank, row;
+    map(addr, channel, bank, row);
+    DRAM_Channel& ch = channels[channel];
+    if (ch.queue.size() >= config.queue_size) return false;
+    ch.queue.push_back({id, addr, is_write, now, bank, row});
+    if (is_write) {
+      writes++;
+    } else {
+      reads++;
+    }
+    return true;
+  }
+
+  // 每个 channel 每周期最多发出一个请求，完成的读请求 id 写入 done
+  // 返回本周期状态是否有变化
+  bool tick(uint64_t now, std::vector<uint64_t>& done) {
+    bool progress = false;
+    for (size_t i = 0; i < in_flight.size();) {
+      if (in_flight[i].done_at <= now) {
+        if (!in_flight[i].is_write) done.push_back(in_flight[i].id);
+        in_flight[i] = in_flight.back();
+        in_flight.pop_back();
+        progress = true;
+      } else {
+        ++i;
+      }
+    }
+
+    for (auto& ch : channels) {
+      if (ch.queue.empty()) continue;
+      int idx = pick(ch, now);
+      if (idx == -1) {
+        // 所有请求的 bank 都在忙，bank 空闲时再调度
+        if (events != nullptr) {
+          uint64_t ready = UINT64_MAX;
+          for (const auto& r : ch.queue) {
+            if (ch.banks[r.bank].ready_at < ready) ready = ch.banks[r.bank].ready_at;
+          }
+          events->schedule(ready);
+        }
+        continue;
+      }
+      progress = true;
+      DRAM_Request r = ch.queue[idx];
+      ch.queue.erase(ch.queue.begin() + idx);
+
+      DRAM_Bank& b = ch.banks[r.bank];
+      uint32_t latency;
+      if (b.open_row == static_cast<int64_t>(r.row)) {
+        latency = config.t_row_hit;
+        row_hits++;
+      } else if (b.open_row == -1) {
+        latency = config.t_row_miss;
+        row_misses++;
+      } else {
+        latency = config.t_row_conflict;
+        row_conflicts++;
+      }
+      b.open_row = config.open_page ? static_cast<int64_t>(r.row) : -1;
+
+      uint64_t done_at = now + latency;
+      if (done_at < ch.bus_free_at + config.t_burst) {
+        done_at = ch.bus_free_at + config.t_burst;
+      }
+      ch.bus_free_at = done_at;
+      bus_busy += config.t_burst;
+      b.ready_at = done_at - config.t_burst;
+
+      total_latency += done_at - r.arrival;
+      if (log != nullptr) log->push_back({r.addr, r.is_write, r.arrival, done_at});
+      in_flight.push_back({r.id, r.is_write, done_at});
+      if (events != nullptr) events->schedule(done_at);
+    }
+    return progress;
+  }
+
+  void register_stats(StatRegistry& stats) {
+    stats.add_counter("dram.reads", &reads);
+    stats.add_counter("dram.writes", &writes);
+    stats.add_counter("dram.row_hits", &row_hits);
+    stats.add_counter("dram.row_misses", &row_misses);
+    stats.add_counter("dram.row_conflicts", &row_conflicts);
+    stats.add_counter("dram.total_latency", &total_latency);
+    stats.add_counter("dram.bus_busy", &bus_busy);
+  }
+
+  bool is_idle() const {
+    if (!in_flight.empty()) return false;
+    for (const auto& ch : channels) {
+      if (!ch.queue.empty()) return false;
+    }
+    return true;
+  }
+
+  void print_stats(std::ostream& os, uint64_t cycles) const {
+    uint64_t served = row_hits + row_misses + row_conflicts;
+    double avg = served ? static_cast<double>(total_latency) / served : 0.0;
+    double util = cycles ? static_cast<double>(bus_busy) / (static_cast<double>(cycles) * config.channels) : 0.0;
+    os << "dram.reads " << reads << "\n"
+       << "dram.writes " << writes << "\n"
+       << "dram.row_hits " << row_hits << "\n"
+       << "dram.row_misses " << row_misses << "\n"
+       << "dram.row_conflicts " << row_conflicts << "\n"
+       << std::fixed << std::setprecision(2)
+       << "dram.avg_latency " << avg << "\n"
+       << "dram.bandwidth_utilization " << util * 100 << "%\n";
+    os.unsetf(std::ios::fixed);
+  }
+};
@@ -0,0 +1,29 @@
+#include <cstdint>
+#include <vector>
+#include <queue>
+#include <functional>
+
+// 未来事件的完成时间（二叉堆），乱序模型在空转时直接跳到最近的事件
+class EventQueue {
+ private:
+  std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t>> heap;
+
+ public:
+  void schedule(uint64_t cycle) {
+    heap.push(cycle);
+  }
+
+  // 返回不早于 now 的最近事件，更早的事件已经处理过，直接丢弃；没有事件时返回 false
+  bool next(uint64_t now, uint64_t& cycle) {
+    while (!heap.empty() && heap.top() < now) {
+      heap.pop();
+    }
+    if (heap.empty()) return false;
+    cycle = heap.top();
+    return true;
+  }
+
+  void clear() {
+    heap = decltype(heap)();
+  }
+};
@@ -0,0 +1,188 @@
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <sstream>
+#include <iomanip>
+#include <ostream>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+// fork 模式：父进程把程序功能运行到指定位置后 fork 出子进程，每个子进程用自己的
+// 存储层次配置从同一状态继续做乱序模拟。客户内存由内核写时复制共享，
+// 子进程把计数器按 "名字 值" 逐行写回管道
+
+struct ForkJob {
+  std::string label;
+  Cache_Config l1;
+  DRAM_Config dram;
+  Core_Config core;
+};
+
+// fork 前最近 window 条指令的访存和条件分支结果，子进程用它预热各自的 L1 和分支预测器
+class WarmupRecorder : public TraceSink {
+ private:
+  struct Access {
+    uint64_t pos;
+    uint32_t addr;
+    bool is_write;
+  };
+  struct Branch {
+    uint64_t pos;
+    uint32_t pc;
+    bool taken;
+  };
+  uint64_t window;
+  uint64_t pos = 0;
+  std::deque<Access> accesses;
+  std::deque<Branch> branches;
+  bool pending = false;   // 最后一条记录是条件分支，结果要看下一条 PC
+  uint32_t branch_pc = 0;
+
+ public:
+  WarmupRecorder(uint64_t w) : window(w) {}
+
+  void record(const TraceRecord& r) override {
+    pos++;
+    if (window == 0) return;
+    if (pending) branches.push_back({pos - 1, branch_pc, r.pc != branch_pc + 4});
+    pending = trace_is_branch(r.inst);
+    branch_pc = r.pc;
+    if (trace_is_memory(r.inst)) accesses.push_back({pos, r.mem_addr, (r.inst & 0x7F) == 0b0100011});
+    while (!accesses.empty() && accesses.front().pos + window <= pos) accesses.pop_front();
+    while (!branches.empty() && branches.front().pos + window <= pos) branches.pop_front();
+  }
+
+  // cpu 已经载入 fork 时的状态，它的 PC 就是最后一个分支之后的那条指令
+  void replay(CPU& cpu) const {
+    for (const auto& a : accesses) cpu.warm_memory(a.addr, a.is_write);
+    for (const auto& b : branches) cpu.warm_branch(b.pc, b.taken);
+    if (pending) cpu.warm_branch(branch_pc, cpu.get_PC() != branch_pc + 4);
+  }
+};
+
+// 每行一组选项，例如 "--l1-size=16384 --dram-banks=4"；空行和 # 开头的行跳过
+inline std::vector<ForkJob> load_fork_jobs(std::istream& in, const Cache_Config& l1, const DRAM_Config& dram,
+                                           const Core_Config& core) {
+  std::vector<ForkJob> jobs;
+  std::string line;
+  while (std::getline(in, line)) {
+    size_t first = line.find_first_not_of(" \t");
+    if (first == std::string::npos || line[first] == '#') continue;
+    ForkJob job{line.substr(first), l1, dram, core};
+    std::istringstream ss(line);
+    std::string arg;
+    while (ss >> arg) {
+      if (!parse_config_option(arg.c_str(), job.l1, job.dram, job.core)) {
+        throw std::runtime_error("unknown option in fork job: " + arg);
+      }
+    }
+    jobs.push_back(job);
+  }
+  return jobs;
+}
+
+class ForkServer {
+ private:
+  struct Child {
+    pid_t pid = -1;
+    int fd = -1;
+    std::string output;
+    int status = 0;
+    bool done = false;
+  };
+
+  [[noreturn]] static void child_main(const CPU& parent, const ForkJob& job, const WarmupRecorder& warm,
+                                      bool skip_idle, int fd) {
+    // 程序自己的输出不应与父进程的表格混在一起
+    int null_fd = ::open("/dev/null", O_WRONLY);
+    if (null_fd >= 0) ::dup2(null_fd, STDOUT_FILENO);
+    CPU cpu(job.l1, job.dram, job.core);
+    cpu.load_state(parent.save_state());
+    warm.replay(cpu);
+    cpu.run(skip_idle);
+    std::ostringstream out;
+    out << "a0 " << cpu.get_register(10) << "\n";
+    for (const auto& [name, value] : cpu.get_stats().get_counters()) out << name << " " << *value << "\n";
+    std::string s = out.str();
+    size_t written = 0;
+    while (written < s.size()) {
+      ssize_t n = ::write(fd, s.data() + written, s.size() - written);
+      if (n <= 0) break;
+      written += n;
+    }
+    ::close(fd);
+    std::fflush(nullptr);
+    ::_exit(written == s.size() ? 0 : 1);
+  }
+
+  static void read_all(Child& c) {
+    char buf[4096];
+    ssize_t n;
+    while ((n = ::read(c.fd, buf, sizeof(buf))) > 0) c.output.append(buf, n);
+    ::close(c.fd);
+  }
+
+ public:
+  // 最多同时 jobs 个子进程，结果按任务顺序写成表格
+  static void run(const CPU& parent, const std::vector<ForkJob>& tasks, const WarmupRecorder& warm,
+                  bool skip_idle, unsigned jobs, std::ostream& os) {
+    std::vector<Child> children(tasks.size());
+    size_t next = 0, running = 0;
+    std::cout.flush();
+    std::cerr.flush();
+    while (next < tasks.size() || running > 0) {
+      while (next < tasks.size() && running < jobs) {
+        int fds[2];
+        if (::pipe(fds) != 0) throw std::runtime_error("pipe failed");
+        pid_t pid = ::fork();
+        if (pid < 0) throw std::runtime_error("fork failed");
+        if (pid == 0) {
+          ::close(fds[0]);
+          child_main(parent, tasks[next], warm, skip_idle, fds[1]);
+        }
+        ::close(fds[1]);
+        children[next].pid = pid;
+        children[next].fd = fds[0];
+        next++;
+        running++;
+      }
+      int status;
+      pid_t pid = ::waitpid(-1, &status, 0);
+      if (pid < 0) break;
+      for (auto& c : children) {
+        if (c.pid != pid || c.done) continue;
+        // 结果只有几 KB，子进程退出前已全部写进管道缓冲区
+        read_all(c);
+        c.status = status;
+        c.done = true;
+        running--;
+      }
+    }
+
+    os << std::fixed << std::setprecision(3);
+    os << "job      cycles  instructions    ipc  mispredicts   l1d_misses  output  config\n";
+    for (size_t i = 0; i < tasks.size(); ++i) {
+      std::map<std::string, uint64_t> r;
+      std::istringstream in(children[i].output);
+      std::string name;
+      uint64_t value;
+      while (in >> name >> value) r[name] = value;
+      bool ok = WIFEXITED(children[i].status) && WEXITSTATUS(children[i].status) == 0 && r.count("cycles");
+      os << std::setw(3) << i << "  ";
+      if (ok) {
+        double ipc = r["cycles"] ? static_cast<double>(r["instructions"]) / r["cycles"] : 0.0;
+        os << std::setw(10) << r["cycles"] << "  " << std::setw(12) << r["instructions"] << "  " << std::setw(5)
+           << ipc << "  " << std::setw(11) << r["branch_mispredicts"] << "  " << std::setw(11) << r["l1d.misses"]
+           << "  " << std::setw(6) << (r["a0"] & 0xFF);
+      } else {
+        os << std::setw(63) << "failed";
+      }
+      os << "  " << tasks[i].label << "\n";
+    }
+    os.unsetf(std::ios::fixed);
+  }
+};
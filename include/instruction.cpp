@@ -1,6 +1,7 @@
 #include <cstdint>
 #include <string>
 #include <bitset>
+#include <cstdio>
 struct Instruction {
   uint32_t code;
 
@@ -19,6 +20,9 @@ struct Instruction {
       case (0b0010111): return 'U'; break;
       case (0b1101111): return 'J'; break;
       case (0b1100011): return 'B'; break;
+      case (0b0101111): return 'A'; break;   // RV32A
+      case (0b0001111): return 'F'; break;   // fence
+      case (0b1110011): return 'C'; break;   // CSR 和 ecall/ebreak
     }
     return 'X';
   }
@@ -112,6 +116,32 @@ struct Instruction {
         case(0b001): return "sh";
         case(0b010): return "sw";
       }
+    } else if (type == 'A') {//A has 11 instructions, funct5 选择操作
+      if (this->get_funct3() != 0b010) return "no instruction";
+      switch(code >> 27) {
+        case(0b00010): return "lr.w";
+        case(0b00011): return "sc.w";
+        case(0b00001): return "amoswap.w";
+        case(0b00000): return "amoadd.w";
+        case(0b00100): return "amoxor.w";
+        case(0b01100): return "amoand.w";
+        case(0b01000): return "amoor.w";
+        case(0b10000): return "amomin.w";
+        case(0b10100): return "amomax.w";
+        case(0b11000): return "amominu.w";
+        case(0b11100): return "amomaxu.w";
+      }
+    } else if (type == 'F') {
+      return "fence";
+    } else if (type == 'C') {
+      switch(this->get_funct3()) {
+        case(0b001): return "csrrw";
+        case(0b010): return "csrrs";
+        case(0b011): return "csrrc";
+        case(0b101): return "csrrwi";
+        case(0b110): return "csrrsi";
+        case(0b111): return "csrrci";
+      }
     }
     return "no instruction";
   }
@@ -128,6 +158,10 @@ struct Instruction {
     return (code >> 20) & 0x1F;
   }
 
+  uint32_t get_csr() {
+    return code >> 20;
+  }
+
   int32_t get_b_imm() {
     int32_t imm = 0;
     imm |= ((code >> 31) & 0x1) << 12;
@@ -202,7 +236,8 @@ inline bool has_rs2(const std::string& op) {
   return (op == "add" || op == "sub" || op == "sll" || op == "slt" ||
           op == "sltu" || op == "xor" || op == "srl" || op == "sra" ||
           op == "or" || op == "and" || op == "beq" || op == "bne" || op == "blt" || op == "bge" ||
-          op == "bltu" || op == "bgeu" || op == "sb" || op == "sh" || op == "sw");
+          op == "bltu" || op == "bgeu" || op == "sb" || op == "sh" || op == "sw" ||
+          op == "sc.w" || op.compare(0, 3, "amo") == 0);
 }
 
 inline bool is_memory(const std::string& op) {
@@ -215,3 +250,54 @@ inline bool is_branch(const std::string& op) {
           op == "bltu" || op == "bgeu" || op == "jal" || op == "jalr");
 }
 
+
+// 反汇编成 "op rd, rs1, imm" 形式，pc 用来算出跳转目标
+inline std::string disassemble(uint32_t code, uint32_t pc) {
+  Instruction ins(code);
+  std::string op = ins.get_op();
+  if (op == "no instruction") return "unknown";
+  auto x = [](uint32_t r) { return "x" + std::to_string(r); };
+  char type = ins.get_type();
+  std::string rd = x(ins.get_rd()), rs1 = x(ins.get_rs1()), rs2 = x(ins.get_rs2());
+  switch (type) {
+    case 'R':
+      return op + " " + rd + ", " + rs1 + ", " + rs2;
+    case 'I':
+      if (is_memory(op) || op == "jalr") {
+        return op + " " + rd + ", " + std::to_string(ins.get_i_imm()) + "(" + rs1 + ")";
+      }
+      if (op == "slli" || op == "srli" || op == "srai") {
+        return op + " " + rd + ", " + rs1 + ", " + std::to_string(ins.get_shamt());
+      }
+      return op + " " + rd + ", " + rs1 + ", " + std::to_string(ins.get_i_imm());
+    case 'S':
+      return op + " " + rs2 + ", " + std::to_string(ins.get_s_imm()) + "(" + rs1 + ")";
+    case 'B': {
+      char buf[16];
+      std::snprintf(buf, sizeof(buf), "0x%x", pc + ins.get_b_imm());
+      return op + " " + rs1 + ", " + rs2 + ", " + buf;
+    }
+    case 'U': {
+      char buf[16];
+      std::snprintf(buf, sizeof(buf), "0x%x", ins.get_u_imm() >> 12);
+      return op + " " + rd + ", " + buf;
+    }
+    case 'J': {
+      char buf[16];
+      std::snprintf(buf, sizeof(buf), "0x%x", pc + ins.get_jal_imm());
+      return op + " " + rd + ", " + buf;
+    }
+    case 'A':
+      if (op == "lr.w") return op + " " + rd + ", (" + rs1 + ")";
+      return op + " " + rd + ", " + rs2 + ", (" + rs1 + ")";
+    case 'F':
+      return op;
+    case 'C': {
+      char buf[16];
+      std::snprintf(buf, sizeof(buf), "0x%x", ins.get_csr());
+      std::string src = op.back() == 'i' ? std::to_string(ins.get_rs1()) : rs1;
+      return op + " " + rd + ", " + buf + ", " + src;
+    }
+  }
+  return "unknown";
+}
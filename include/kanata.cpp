@@ -0,0 +1,114 @@
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <stdexcept>
+
+// Kanata 0004 格式的流水线日志，可以用 Konata 查看。
+// 模拟线程只把事件放进环形缓冲区，格式化和写文件都在后台线程完成
+
+enum class PipeStage : uint8_t {
+  FETCH, ISSUE, DISPATCH, EXECUTE, MEMORY, WRITEBACK
+};
+
+const char* const PIPE_STAGE_NAMES[] = {"F", "Is", "Ds", "X", "M", "Wb"};
+
+struct PipeEvent {
+  uint64_t cycle;
+  uint64_t id;
+  uint32_t a;     // I: pc，S: 阶段，R: 提交序号
+  uint32_t b;     // I: 指令原码，R: 0 提交 / 1 冲刷
+  char kind;      // 'I'、'S' 或 'R'
+};
+
+class KanataWriter {
+ private:
+  SpscRing<PipeEvent> ring{16};
+  std::atomic<bool> stopping{false};
+  std::thread writer;
+  FILE* out;
+  std::string buffer;
+  uint64_t last_cycle = 0;
+
+  void format(const PipeEvent& e) {
+    char line[128];
+    if (e.cycle > last_cycle) {
+      std::snprintf(line, sizeof(line), "C\t%llu\n", static_cast<unsigned long long>(e.cycle - last_cycle));
+      buffer += line;
+      last_cycle = e.cycle;
+    }
+    unsigned long long id = e.id;
+    switch (e.kind) {
+      case 'I':
+        std::snprintf(line, sizeof(line), "I\t%llu\t%llu\t0\nL\t%llu\t0\t%08x: ", id, id, id, e.a);
+        buffer += line;
+        buffer += disassemble(e.b, e.a);
+        buffer += '\n';
+        break;
+      case 'S':
+        std::snprintf(line, sizeof(line), "S\t%llu\t0\t%s\n", id, PIPE_STAGE_NAMES[e.a]);
+        buffer += line;
+        break;
+      case 'R':
+        std::snprintf(line, sizeof(line), "R\t%llu\t%u\t%u\n", id, e.a, e.b);
+        buffer += line;
+        break;
+    }
+  }
+
+  void writer_loop() {
+    while (true) {
+      bool stop = stopping.load(std::memory_order_acquire);
+      uint64_t n = ring.drain([this](const PipeEvent& e) { format(e); });
+      if (buffer.size() >= (1 << 20) || (n == 0 && !buffer.empty())) {
+        std::fwrite(buffer.data(), 1, buffer.size(), out);
+        buffer.clear();
+      }
+      if (stop && n == 0) break;
+      if (n == 0) std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    std::fflush(out);
+  }
+
+ public:
+  KanataWriter(const std::string& path) {
+    out = std::fopen(path.c_str(), "w");
+    if (out == nullptr) throw std::runtime_error("Cannot open pipeline log: " + path);
+    std::fputs("Kanata\t0004\nC=\t0\n", out);
+    buffer.reserve(1 << 21);
+    writer = std::thread(&KanataWriter::writer_loop, this);
+  }
+
+  ~KanataWriter() {
+    stop();
+  }
+
+  KanataWriter(const KanataWriter&) = delete;
+  KanataWriter& operator=(const KanataWriter&) = delete;
+
+  // 以下只在模拟线程调用
+  void fetch(uint64_t cycle, uint64_t id, uint32_t pc, uint32_t inst) {
+    ring.push({cycle, id, pc, inst, 'I'});
+  }
+
+  void stage(uint64_t cycle, uint64_t id, PipeStage s) {
+    ring.push({cycle, id, static_cast<uint32_t>(s), 0, 'S'});
+  }
+
+  void retire(uint64_t cycle, uint64_t id, uint32_t retire_id) {
+    ring.push({cycle, id, retire_id, 0, 'R'});
+  }
+
+  void squash(uint64_t cycle, uint64_t id) {
+    ring.push({cycle, id, 0, 1, 'R'});
+  }
+
+  void stop() {
+    if (!writer.joinable()) return;
+    stopping.store(true, std::memory_order_release);
+    writer.join();
+    std::fclose(out);
+  }
+};
@@ -0,0 +1,42 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <istream>
+#include <algorithm>
+
+// 读入 "@地址" 加十六进制字节的程序镜像，lo/hi 返回载入的地址范围 [lo, hi)
+inline void load_image(CPU& cpu, std::istream& in, uint32_t& lo, uint32_t& hi) {
+  std::string s;
+  uint32_t store_pos = 0;
+  lo = UINT32_MAX;
+  hi = 0;
+  while (std::getline(in, s)) {
+    if (s.empty()) continue;
+    if (s[0] == '@') {
+      store_pos = static_cast<uint32_t>(std::stoi(s.substr(1), nullptr, 16));
+    } else {
+      s.erase(std::remove(s.begin(), s.end(), ' '), s.end());
+      for (size_t i = 0; i + 1 < s.length(); i += 2) {
+        uint8_t byte = static_cast<uint8_t>(std::stoi(s.substr(i, 2), nullptr, 16));
+        cpu.cpu_write_byte(store_pos, byte);
+        lo = std::min(lo, store_pos);
+        hi = std::max(hi, store_pos + 1);
+        store_pos += 1;
+      }
+    }
+  }
+}
+
+// 从 checkpoint 恢复时没有镜像的地址范围，取 pc 所在的那段连续的已分配页，[lo, hi)
+inline void resident_range(const CPU& cpu, uint32_t pc, uint32_t& lo, uint32_t& hi) {
+  lo = UINT32_MAX;
+  hi = 0;
+  std::vector<uint32_t> pages = cpu.save_state().mem.page_numbers();
+  auto it = std::lower_bound(pages.begin(), pages.end(), pc >> PAGE_BITS);
+  if (it == pages.end() || *it != pc >> PAGE_BITS) return;
+  auto first = it, last = it;
+  while (first != pages.begin() && *(first - 1) + 1 == *first) --first;
+  while (last + 1 != pages.end() && *(last + 1) == *last + 1) ++last;
+  lo = *first << PAGE_BITS;
+  hi = static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(*last + 1) << PAGE_BITS, UINT32_MAX));
+}
@@ -1,19 +1,134 @@
 #include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <algorithm>
 #include <unordered_map>
+#include <unordered_set>
 #include <stdexcept>
 #include <cstdio>
+#include <atomic>
 
 const int MEMORY_SIZE = 1 << 20;
+const uint32_t PAGE_BITS = 12;
+const uint32_t PAGE_SIZE = 1u << PAGE_BITS;
 
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "guest words are accessed in host byte order");
+
+// 多个 hart 共用的物理页：按页号直接索引，页一旦分配就不再释放，分配用 CAS，
+// 页内数据用原子操作读写，所以各 hart 的 Memory 可以在不同线程里同时访问
+class SharedPages {
+ private:
+  static constexpr uint32_t PAGE_COUNT = 1u << (32 - PAGE_BITS);
+  std::unique_ptr<std::atomic<uint8_t*>[]> table;
+
+ public:
+  SharedPages() : table(new std::atomic<uint8_t*>[PAGE_COUNT]()) {}
+  ~SharedPages() {
+    for (uint32_t i = 0; i < PAGE_COUNT; ++i) delete[] table[i].load();
+  }
+
+  SharedPages(const SharedPages&) = delete;
+  SharedPages& operator=(const SharedPages&) = delete;
+
+  uint8_t* find(uint32_t tag) const {
+    return table[tag].load(std::memory_order_acquire);
+  }
+
+  uint8_t* get(uint32_t tag) {
+    uint8_t* p = find(tag);
+    if (p != nullptr) return p;
+    uint8_t* fresh = new uint8_t[PAGE_SIZE]();
+    if (table[tag].compare_exchange_strong(p, fresh, std::memory_order_acq_rel)) return fresh;
+    delete[] fresh;
+    return p;
+  }
+
+  std::vector<uint32_t> tags() const {
+    std::vector<uint32_t> result;
+    for (uint32_t i = 0; i < PAGE_COUNT; ++i) {
+      if (find(i) != nullptr) result.push_back(i);
+    }
+    return result;
+  }
+};
+
+// 内存按 4KB 分页，只为写过的页分配空间。页面可以被共享（例如从 checkpoint 文件映射进来），
+// 写入前若不是独占就先复制一份
 class Memory {
  private:
   uint32_t PC;
-  std::unordered_map<uint32_t, uint8_t> memory;
+  std::unordered_map<uint32_t, std::shared_ptr<uint8_t>> pages;
+  std::unordered_set<uint32_t> dirty;   // 上次 clear_dirty 之后写过的页
+  std::shared_ptr<SharedPages> shared;  // 非空时页面都在这里，pages 不用，也不记脏页
+  // 最近访问过的页，避免每个字节都查一次哈希表
+  mutable uint32_t read_tag = UINT32_MAX;
+  mutable const uint8_t* read_page = nullptr;
+  mutable uint32_t write_tag = UINT32_MAX;
+  mutable uint8_t* write_page = nullptr;
+
+  const uint8_t* find_page(uint32_t tag) const {
+    if (shared) {
+      // 别的 hart 随时可能分配这一页，所以不缓存找不到的结果
+      if (tag == read_tag) return read_page;
+      const uint8_t* p = shared->find(tag);
+      if (p != nullptr) {
+        read_tag = tag;
+        read_page = p;
+      }
+      return p;
+    }
+    if (tag != read_tag) {
+      auto it = pages.find(tag);
+      read_page = it != pages.end() ? it->second.get() : nullptr;
+      read_tag = tag;
+    }
+    return read_page;
+  }
+
+  uint8_t* writable_page(uint32_t tag) {
+    if (tag == write_tag) return write_page;
+    if (shared) {
+      write_tag = tag;
+      write_page = shared->get(tag);
+      return write_page;
+    }
+    std::shared_ptr<uint8_t>& p = pages[tag];
+    if (!p || p.use_count() > 1) {
+      std::shared_ptr<uint8_t> copy(new uint8_t[PAGE_SIZE], std::default_delete<uint8_t[]>());
+      if (p) {
+        std::memcpy(copy.get(), p.get(), PAGE_SIZE);
+      } else {
+        std::memset(copy.get(), 0, PAGE_SIZE);
+      }
+      p = std::move(copy);
+      read_tag = UINT32_MAX;
+    }
+    dirty.insert(tag);
+    write_tag = tag;
+    write_page = p.get();
+    return write_page;
+  }
 
  public:
   Memory() : PC(0x00000000) {}
   ~Memory() = default;
 
+  // 复制只共享页面，两边第一次写某页时各自复制
+  Memory(const Memory& other) : PC(other.PC), pages(other.pages), dirty(other.dirty), shared(other.shared) {
+    other.write_tag = UINT32_MAX;
+  }
+  Memory& operator=(const Memory& other) {
+    other.write_tag = UINT32_MAX;
+    PC = other.PC;
+    pages = other.pages;
+    dirty = other.dirty;
+    shared = other.shared;
+    read_tag = write_tag = UINT32_MAX;
+    write_page = nullptr;
+    return *this;
+  }
+
   uint32_t get_PC() const {
     return PC;
   }
@@ -31,39 +146,71 @@ class Memory {
   }
 
   void write_byte(uint32_t pos, uint8_t val) {
-    memory[pos] = val;
+    uint8_t* p = writable_page(pos >> PAGE_BITS) + (pos & (PAGE_SIZE - 1));
+    if (shared) {
+      __atomic_store_n(p, val, __ATOMIC_RELAXED);
+    } else {
+      *p = val;
+    }
   }
 
+  // 共享时对齐的半字和字整体写入，其他 hart 不会看到写了一半的值
   void write_halfword(uint32_t pos, uint16_t val) {
-    memory[pos]     = val & 0xFF;
-    memory[pos + 1] = (val >> 8) & 0xFF;
+    if (shared && (pos & 1) == 0) {
+      uint8_t* p = writable_page(pos >> PAGE_BITS) + (pos & (PAGE_SIZE - 1));
+      __atomic_store_n(reinterpret_cast<uint16_t*>(p), val, __ATOMIC_RELAXED);
+      return;
+    }
+    write_byte(pos, val & 0xFF);
+    write_byte(pos + 1, (val >> 8) & 0xFF);
   }
 
   void write_word(uint32_t pos, uint32_t val) {
-    memory[pos]     = val & 0xFF;
-    memory[pos + 1] = (val >> 8) & 0xFF;
-    memory[pos + 2] = (val >> 16) & 0xFF;
-    memory[pos + 3] = (val >> 24) & 0xFF;
+    if (shared && (pos & 3) == 0) {
+      uint8_t* p = writable_page(pos >> PAGE_BITS) + (pos & (PAGE_SIZE - 1));
+      __atomic_store_n(reinterpret_cast<uint32_t*>(p), val, __ATOMIC_RELAXED);
+      return;
+    }
+    write_byte(pos, val & 0xFF);
+    write_byte(pos + 1, (val >> 8) & 0xFF);
+    write_byte(pos + 2, (val >> 16) & 0xFF);
+    write_byte(pos + 3, (val >> 24) & 0xFF);
   }
 
   uint8_t read_byte(uint32_t pos) const {
-    auto it = memory.find(pos);
-    return (it != memory.end()) ? it->second : 0;
+    const uint8_t* page = find_page(pos >> PAGE_BITS);
+    if (page == nullptr) return 0;
+    if (shared) return __atomic_load_n(page + (pos & (PAGE_SIZE - 1)), __ATOMIC_RELAXED);
+    return page[pos & (PAGE_SIZE - 1)];
   }
 
   uint16_t read_halfword(uint32_t pos) const {
+    if (shared && (pos & 1) == 0) {
+      const uint8_t* page = find_page(pos >> PAGE_BITS);
+      if (page == nullptr) return 0;
+      return __atomic_load_n(reinterpret_cast<const uint16_t*>(page + (pos & (PAGE_SIZE - 1))), __ATOMIC_RELAXED);
+    }
     uint8_t low  = read_byte(pos);
     uint8_t high = read_byte(pos + 1);
     return static_cast<uint16_t>(low | (high << 8));
   }
 
   uint32_t read_word(uint32_t pos) const {
+    uint32_t off = pos & (PAGE_SIZE - 1);
+    if (off <= PAGE_SIZE - 4) {
+      const uint8_t* page = find_page(pos >> PAGE_BITS);
+      if (page == nullptr) return 0;
+      if (shared && (off & 3) == 0) {
+        return __atomic_load_n(reinterpret_cast<const uint32_t*>(page + off), __ATOMIC_RELAXED);
+      }
+      return static_cast<uint32_t>(page[off]) | (static_cast<uint32_t>(page[off + 1]) << 8) |
+             (static_cast<uint32_t>(page[off + 2]) << 16) | (static_cast<uint32_t>(page[off + 3]) << 24);
+    }
     return static_cast<uint32_t>(read_byte(pos)) |
            (static_cast<uint32_t>(read_byte(pos + 1)) << 8) |
            (static_cast<uint32_t>(read_byte(pos + 2)) << 16) |
            (static_cast<uint32_t>(read_byte(pos + 3)) << 24);
   }
-
   int8_t read_byte_signed(uint32_t pos) const {
     return static_cast<int8_t>(read_byte(pos));
   }
@@ -71,4 +218,79 @@ class Memory {
   int16_t read_halfword_signed(uint32_t pos) const {
     return static_cast<int16_t>(read_halfword(pos));
   }
+
+  // 对齐字上的原子读-改-写，f 由旧值算出新值，返回旧值
+  template <typename F>
+  uint32_t atomic_update(uint32_t pos, F f) {
+    uint32_t* word = atomic_word(pos);
+    uint32_t old = __atomic_load_n(word, __ATOMIC_SEQ_CST);
+    while (!__atomic_compare_exchange_n(word, &old, f(old), false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+    }
+    return old;
+  }
+
+  bool compare_exchange_word(uint32_t pos, uint32_t expected, uint32_t desired) {
+    return __atomic_compare_exchange_n(atomic_word(pos), &expected, desired, false, __ATOMIC_SEQ_CST,
+                                       __ATOMIC_SEQ_CST);
+  }
+
+  uint32_t load_word_atomic(uint32_t pos) {
+    return __atomic_load_n(atomic_word(pos), __ATOMIC_SEQ_CST);
+  }
+
+  // 把已有的页搬进 s，之后的读写都经过它
+  void share(std::shared_ptr<SharedPages> s) {
+    for (const auto& [tag, data] : pages) std::memcpy(s->get(tag), data.get(), PAGE_SIZE);
+    pages.clear();
+    dirty.clear();
+    shared = std::move(s);
+    read_tag = write_tag = UINT32_MAX;
+    write_page = nullptr;
+  }
+
+  // 已分配的页号，按升序
+  std::vector<uint32_t> page_numbers() const {
+    if (shared) return shared->tags();
+    std::vector<uint32_t> tags;
+    for (const auto& p : pages) tags.push_back(p.first);
+    std::sort(tags.begin(), tags.end());
+    return tags;
+  }
+
+  // 上次 clear_dirty 之后写过的页号，按升序
+  std::vector<uint32_t> dirty_pages() const {
+    std::vector<uint32_t> tags(dirty.begin(), dirty.end());
+    std::sort(tags.begin(), tags.end());
+    return tags;
+  }
+
+  // 之后第一次写某页时才重新记为脏页，所以要让写缓存失效
+  void clear_dirty() {
+    dirty.clear();
+    write_tag = UINT32_MAX;
+    write_page = nullptr;
+  }
+
+  uint32_t* atomic_word(uint32_t pos) {
+    if (pos & 3) throw std::runtime_error("Misaligned atomic memory access");
+    return reinterpret_cast<uint32_t*>(writable_page(pos >> PAGE_BITS) + (pos & (PAGE_SIZE - 1)));
+  }
+
+  const uint8_t* page_data(uint32_t tag) const {
+    return find_page(tag);
+  }
+
+  // 直接换上一页（只读共享），之前的内容被丢弃
+  void map_page(uint32_t tag, std::shared_ptr<uint8_t> data) {
+    pages[tag] = std::move(data);
+    read_tag = write_tag = UINT32_MAX;
+    write_page = nullptr;
+  }
+
+  void clear() {
+    pages.clear();
+    dirty.clear();
+    read_tag = write_tag = UINT32_MAX;
+    write_page = nullptr;
+  }
 };
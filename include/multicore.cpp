@@ -0,0 +1,237 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// 多核时序模拟（bound-weave）：每个核跑自己的程序，有私有 L1，共用一个 DRAM。
+// bound 阶段各核在自己的线程里独立跑一个 quantum，只看到自己的访存争用，同时记下发给 DRAM 的请求；
+// 所有核到达 quantum 边界后，weave 阶段把这些请求按到达时间送进共享 DRAM，
+// 比共享时多出来的延迟在下一个 quantum 开始时以停顿的方式补给对应的核。
+// quantum 越大同步越少，但延迟补得越晚，结果越不准
+
+struct CoreResult {
+  std::string label;
+  bool halted = false;
+  uint32_t exit_code = 0;
+  uint64_t cycles = 0;
+  uint64_t instructions = 0;
+  uint64_t contention = 0;   // 因共享 DRAM 争用补上的停顿周期
+};
+
+// 所有线程到齐后由最后一个到达的线程执行 on_last，再一起放行
+class QuantumBarrier {
+ private:
+  std::mutex lock;
+  std::condition_variable cv;
+  size_t count;
+  size_t waiting = 0;
+  uint64_t generation = 0;
+
+ public:
+  QuantumBarrier(size_t n) : count(n) {}
+
+  template <typename F>
+  void arrive_and_wait(F&& on_last) {
+    std::unique_lock<std::mutex> guard(lock);
+    uint64_t gen = generation;
+    if (++waiting == count) {
+      on_last();
+      waiting = 0;
+      generation++;
+      cv.notify_all();
+      return;
+    }
+    cv.wait(guard, [this, gen] { return generation != gen; });
+  }
+};
+
+class MultiCore {
+ private:
+  struct Core {
+    std::string label;
+    std::unique_ptr<CPU> cpu;
+    std::vector<DRAM_Access> log;   // 本 quantum 发给 DRAM 的请求
+    std::vector<std::pair<uint64_t, uint64_t>> late;   // 还没补上的争用：bound 阶段和共享时的完成周期
+    uint64_t contention = 0;
+  };
+
+  struct SharedRequest {
+    uint32_t core;
+    uint32_t addr;
+    bool is_write;
+    uint64_t arrival;
+    uint64_t bound_done;
+    uint64_t shared_done;
+  };
+
+  std::vector<Core> cores;
+  DRAM shared;
+  uint64_t quantum;
+  bool skip_idle;
+
+  // 各核的地址空间互相独立，在共享 DRAM 里按核号错开，避免不同核的同一地址算成 row hit
+  static uint32_t shared_addr(uint32_t core, uint32_t addr) {
+    return addr ^ (core << 26);
+  }
+
+  // 本 quantum 所有核的请求按到达时间进共享 DRAM。读请求比 bound 阶段晚完成的部分就是争用延迟，
+  // 同一个核重叠的延迟只算一次（访存并行时核只等最长的那个）
+  void weave() {
+    std::vector<SharedRequest> reqs;
+    for (uint32_t c = 0; c < cores.size(); ++c) {
+      for (const auto& a : cores[c].log) {
+        reqs.push_back({c, shared_addr(c, a.addr), a.is_write, a.arrival, a.done_at, a.done_at});
+      }
+      cores[c].log.clear();
+    }
+    std::stable_sort(reqs.begin(), reqs.end(),
+                     [](const SharedRequest& a, const SharedRequest& b) { return a.arrival < b.arrival; });
+
+    std::vector<uint64_t> done;
+    size_t next = 0;
+    uint64_t now = reqs.empty() ? 0 : reqs[0].arrival;
+    while (next < reqs.size() || !shared.is_idle()) {
+      while (next < reqs.size() && reqs[next].arrival <= now && shared.can_accept(reqs[next].addr)) {
+        shared.enqueue(next, reqs[next].addr, reqs[next].is_write, reqs[next].arrival);
+        next++;
+      }
+      done.clear();
+      shared.tick(now, done);
+      for (uint64_t id : done) reqs[id].shared_done = now;
+      // DRAM 空闲时直接跳到下一个请求到达
+      if (shared.is_idle() && next < reqs.size()) {
+        now = std::max(now + 1, reqs[next].arrival);
+      } else {
+        now++;
+      }
+    }
+
+    for (const auto& r : reqs) {
+      if (!r.is_write && r.shared_done > r.bound_done) cores[r.core].late.push_back({r.bound_done, r.shared_done});
+    }
+    // 只补 bound 阶段里已经返回的读请求，还没返回的留到以后的 quantum，这样 quantum 小于访存延迟时也不会提前停顿
+    for (auto& core : cores) {
+      std::sort(core.late.begin(), core.late.end());
+      uint64_t now = core.cpu->get_cycle(), delay = 0, covered = 0;
+      size_t n = 0;
+      for (; n < core.late.size() && core.late[n].first <= now; ++n) {
+        uint64_t start = std::max(core.late[n].first, covered);
+        if (core.late[n].second > start) delay += core.late[n].second - start;
+        covered = std::max(covered, core.late[n].second);
+      }
+      core.late.erase(core.late.begin(), core.late.begin() + n);
+      // 在 quantum 中间停机的核也要补，停机时间跟着推后
+      core.cpu->stall(delay);
+      core.contention += delay;
+    }
+  }
+
+ public:
+  // 每个任务一个核；共享 DRAM 用 dram 配置，任务自己的 DRAM 选项只影响 bound 阶段
+  MultiCore(const std::vector<BatchJob>& jobs, const DRAM_Config& dram, uint64_t q, bool skip)
+      : shared(dram), quantum(std::max<uint64_t>(1, q)), skip_idle(skip) {
+    if (jobs.empty()) throw std::runtime_error("Multicore manifest lists no program");
+    cores.resize(jobs.size());
+    for (size_t i = 0; i < jobs.size(); ++i) {
+      std::ifstream in(jobs[i].path);
+      if (!in) throw std::runtime_error("Cannot open " + jobs[i].path);
+      cores[i].label = jobs[i].label;
+      cores[i].cpu = std::make_unique<CPU>(jobs[i].l1, jobs[i].dram, jobs[i].core);
+      cores[i].cpu->set_output(nullptr);
+      uint32_t lo, hi;
+      load_image(*cores[i].cpu, in, lo, hi);
+      cores[i].cpu->cpu_set_PC(0x0);
+      cores[i].cpu->set_dram_log(&cores[i].log);
+    }
+  }
+
+  // threads 个线程分担各核（线程 t 负责核 t, t + threads, ...），返回墙钟秒数
+  double run(unsigned threads) {
+    threads = std::max(1u, std::min<unsigned>(threads, cores.size()));
+    QuantumBarrier barrier(threads);
+    uint64_t end = quantum;
+    bool finished = false;
+    auto body = [&](unsigned t) {
+      while (true) {
+        for (size_t c = t; c < cores.size(); c += threads) {
+          if (!cores[c].cpu->is_halted()) cores[c].cpu->run(skip_idle, UINT64_MAX, end);
+        }
+        barrier.arrive_and_wait([&] {
+          weave();
+          end += quantum;
+          finished = std::all_of(cores.begin(), cores.end(), [](const Core& c) { return c.cpu->is_halted(); });
+        });
+        if (finished) return;
+      }
+    };
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(body, t);
+    body(0);
+    for (auto& p : pool) p.join();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  std::vector<CoreResult> results() const {
+    std::vector<CoreResult> r;
+    for (const auto& c : cores) {
+      r.push_back({c.label, c.cpu->is_halted(), c.cpu->get_exit_code(), c.cpu->get_cycle(), c.cpu->get_instret(),
+                   c.contention});
+    }
+    return r;
+  }
+
+  static void print(std::ostream& os, const std::vector<CoreResult>& results) {
+    os << std::left << std::setw(6) << "core" << std::setw(8) << "output" << std::right << std::setw(12) << "cycles"
+       << std::setw(12) << "insts" << std::setw(8) << "ipc" << std::setw(12) << "contention" << "  program\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+      const CoreResult& r = results[i];
+      os << std::left << std::setw(6) << i << std::setw(8) << (r.halted ? std::to_string(r.exit_code) : "-")
+         << std::right << std::setw(12) << r.cycles << std::setw(12) << r.instructions << std::setw(8)
+         << std::fixed << std::setprecision(3) << (r.cycles ? static_cast<double>(r.instructions) / r.cycles : 0.0)
+         << std::setw(12) << r.contention << "  " << r.label << "\n";
+      os.unsetf(std::ios::fixed);
+    }
+  }
+
+  // 精度与加速比：以 quantum 为 1 的单线程运行为基准，逐个 quantum 多线程运行，
+  // 误差是各核周期数相对基准的偏差
+  static void tradeoff(std::ostream& os, const std::vector<BatchJob>& jobs, const DRAM_Config& dram,
+                       const std::vector<uint64_t>& quanta, bool skip_idle) {
+    MultiCore reference(jobs, dram, 1, skip_idle);
+    double base = reference.run(1);
+    std::vector<CoreResult> expect = reference.results();
+    os << "reference: quantum 1, 1 thread, " << base << " s\n";
+    print(os, expect);
+    os << "\n" << std::setw(10) << "quantum" << std::setw(10) << "threads" << std::setw(12) << "seconds"
+       << std::setw(10) << "speedup" << std::setw(12) << "mean_err%" << std::setw(12) << "max_err%" << "\n";
+    for (uint64_t q : quanta) {
+      MultiCore sim(jobs, dram, q, skip_idle);
+      double seconds = sim.run(jobs.size());
+      std::vector<CoreResult> got = sim.results();
+      double sum = 0, worst = 0;
+      for (size_t i = 0; i < got.size(); ++i) {
+        double err = expect[i].cycles ? 100.0 * std::abs(static_cast<double>(got[i].cycles) - expect[i].cycles) /
+                                            expect[i].cycles
+                                      : 0.0;
+        sum += err;
+        worst = std::max(worst, err);
+      }
+      os << std::setw(10) << q << std::setw(10) << jobs.size() << std::fixed << std::setprecision(4)
+         << std::setw(12) << seconds << std::setprecision(2) << std::setw(10) << (seconds > 0 ? base / seconds : 0.0)
+         << std::setprecision(3) << std::setw(12) << sum / got.size() << std::setw(12) << worst << "\n";
+      os.unsetf(std::ios::fixed);
+    }
+    os << std::flush;
+  }
+};
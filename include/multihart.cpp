@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <stdexcept>
+
+// 多 hart 功能模拟：每个 hart 一个宿主线程，内存经 SharedPages 共享，RV32A 用宿主机的原子操作实现。
+// 所有 hart 从同一个 PC 开始，程序用 csrr mhartid 区分自己（例如各自设置 sp）；
+// hart 0 停机或达到指令数上限时整个运行结束，只有 hart 0 打印返回值
+class MultiHart {
+ public:
+  // boot 是已经载入程序的 hart 0；max_insts 是每个 hart 的上限；coherence 非空时各 hart 的访存送进一致性模型。
+  // 返回 hart 0 是否停机
+  static bool run(CPU& boot, uint32_t harts, uint64_t max_insts, std::ostream& report,
+                  CoherenceModel* coherence = nullptr) {
+    auto pages = std::make_shared<SharedPages>();
+    boot.share_memory(pages);
+    std::vector<std::unique_ptr<CPU>> others;
+    for (uint32_t i = 1; i < harts; ++i) {
+      others.push_back(std::make_unique<CPU>());
+      others.back()->share_memory(pages);
+      others.back()->set_hart_id(i);
+      others.back()->set_output(nullptr);
+      others.back()->cpu_set_PC(boot.get_PC());
+    }
+    std::vector<CPU*> cpus{&boot};
+    for (auto& c : others) cpus.push_back(c.get());
+    std::vector<std::unique_ptr<CoherenceSink>> sinks;
+    if (coherence != nullptr) {
+      for (uint32_t i = 0; i < harts; ++i) {
+        sinks.push_back(std::make_unique<CoherenceSink>(*coherence, i));
+        cpus[i]->set_tracer(sinks.back().get());
+      }
+    }
+
+    std::atomic<bool> stop{false};
+    std::vector<uint64_t> executed(harts, 0);
+    std::vector<std::string> errors(harts);
+    auto start = std::chrono::steady_clock::now();
+    auto body = [&](uint32_t id) {
+      CPU& cpu = *cpus[id];
+      uint64_t n = 0;
+      // 异常不能逃出宿主线程（会直接 terminate），记下来停掉所有 hart，join 之后再抛
+      try {
+        // 分块执行，块之间检查 hart 0 是否已结束
+        while (n < max_insts && !cpu.is_halted() && !stop.load(std::memory_order_relaxed)) {
+          n += cpu.run_functional(std::min<uint64_t>(max_insts - n, 1024));
+        }
+      } catch (const std::exception& e) {
+        errors[id] = e.what();
+        stop = true;
+      }
+      executed[id] = n;
+      if (id == 0) stop = true;
+    };
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < harts; ++i) threads.emplace_back(body, i);
+    body(0);
+    for (auto& t : threads) t.join();
+    for (uint32_t i = 0; i < harts; ++i) {
+      if (!errors[i].empty()) throw std::runtime_error("hart " + std::to_string(i) + ": " + errors[i]);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < harts; ++i) {
+      report << "hart " << i << ": " << executed[i] << " instructions" << (cpus[i]->is_halted() ? ", halted" : "")
+             << std::endl;
+      total += executed[i];
+    }
+    report << harts << " harts, " << total << " instructions in " << seconds << " s ("
+           << (seconds > 0 ? total / seconds / 1e6 : 0.0) << " MIPS)" << std::endl;
+    if (coherence != nullptr) {
+      coherence->report(report);
+      boot.set_tracer(nullptr);
+    }
+    return boot.is_halted();
+  }
+};
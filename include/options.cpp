@@ -0,0 +1,50 @@
+#include <cstring>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+
+// 形如 --name=value 的参数，匹配时把值写入 value
+inline bool parse_option(const char* arg, const char* name, std::string& value) {
+  size_t len = std::strlen(name);
+  if (std::strncmp(arg, name, len) != 0 || arg[len] != '=') return false;
+  value = arg + len + 1;
+  return true;
+}
+
+// DRAM 的 channel、bank 和队列数至少为 1，0 会让地址映射除零或者请求永远进不了队列
+inline uint32_t parse_positive(const char* name, const std::string& value) {
+  unsigned long n = std::stoul(value);
+  if (n < 1) throw std::runtime_error(std::string(name) + " must be at least 1");
+  return n;
+}
+
+// 乱序核和存储层次的配置参数，主程序和 fork、批量、扫描模式的每个任务共用
+inline bool parse_config_option(const char* arg, Cache_Config& l1, DRAM_Config& dram, Core_Config& core) {
+  std::string value;
+  if (parse_option(arg, "--rob-size", value)) {
+    core.rob_size = std::max(1ul, std::stoul(value));
+  } else if (parse_option(arg, "--rs-size", value)) {
+    core.rs_size = std::max(1ul, std::stoul(value));
+  } else if (parse_option(arg, "--lsb-size", value)) {
+    core.lsb_size = std::max(1ul, std::stoul(value));
+  } else if (parse_option(arg, "--issue-width", value)) {
+    core.width = std::max(1ul, std::stoul(value));
+  } else if (parse_option(arg, "--predictor", value)) {
+    core.predictor = parse_predictor_type(value);
+  } else if (parse_option(arg, "--dram-channels", value)) {
+    dram.channels = parse_positive("--dram-channels", value);
+  } else if (parse_option(arg, "--dram-banks", value)) {
+    dram.banks = parse_positive("--dram-banks", value);
+  } else if (parse_option(arg, "--dram-queue", value)) {
+    dram.queue_size = parse_positive("--dram-queue", value);
+  } else if (parse_option(arg, "--dram-page", value)) {
+    dram.open_page = (value != "closed");
+  } else if (parse_option(arg, "--l1-size", value)) {
+    l1.size = std::stoul(value);
+  } else if (parse_option(arg, "--l1-ways", value)) {
+    l1.ways = std::stoul(value);
+  } else {
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,98 @@
+#include <cstdint>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <ostream>
+
+// 功能模型先行：功能模型在自己的线程里执行程序，把提交的每条指令（结果和访存地址）
+// 经无锁环形缓冲区送给另一个线程里的乱序模型。乱序模型按回放方式运行，只算时序不算数值，
+// 错误路径仍由它自己的分支预测器决定：预测和 oracle 给出的下一条 PC 不同时，沿预测路径从乱序模型
+// 自己的程序镜像取指，这些指令占用后端资源并访问 cache，直到该分支提交时冲刷
+class OracleStream : public TraceSink, public TraceSource {
+ private:
+  SpscRing<TraceRecord> ring{16};
+  std::atomic<bool> finished{false};
+  std::vector<TraceRecord> batch;   // 消费者一次取出的记录
+  size_t index = 0;
+  uint64_t produced = 0;
+  uint64_t waits = 0;               // 乱序模型等功能模型的次数
+
+ public:
+  OracleStream() {
+    batch.reserve(1 << 16);
+  }
+
+  OracleStream(const OracleStream&) = delete;
+  OracleStream& operator=(const OracleStream&) = delete;
+
+  // 只在功能模型线程调用
+  void record(const TraceRecord& r) override {
+    ring.push(r);
+    produced++;
+  }
+
+  void finish() {
+    finished.store(true, std::memory_order_release);
+  }
+
+  // 只在乱序模型线程调用；流空时等功能模型，功能模型结束且流已取完时返回 false
+  bool next(TraceRecord& r) override {
+    while (index == batch.size()) {
+      batch.clear();
+      index = 0;
+      bool done = finished.load(std::memory_order_acquire);
+      ring.drain([this](const TraceRecord& rec) { batch.push_back(rec); });
+      if (!batch.empty()) break;
+      if (done) return false;
+      waits++;
+      std::this_thread::yield();
+    }
+    r = batch[index++];
+    return true;
+  }
+
+  uint64_t get_produced() const { return produced; }
+  uint64_t get_waits() const { return waits; }
+};
+
+// 功能模型线程：从 boot 的状态开始执行，最多 max_insts 条，产生 oracle 流
+class FunctionalOracle {
+ private:
+  CPU functional;
+  OracleStream stream;
+  std::thread producer;
+  std::chrono::steady_clock::time_point start;
+
+ public:
+  FunctionalOracle(const CPU& boot, uint64_t max_insts) : start(std::chrono::steady_clock::now()) {
+    functional.load_state(boot.save_state());
+    functional.set_output(nullptr);
+    functional.set_tracer(&stream);
+    producer = std::thread([this, max_insts] {
+      functional.run_functional(max_insts);
+      // 停机指令本身不进 trace，单独送一条，乱序模型据此得到最后一条指令实际的下一条 PC
+      if (functional.is_halted()) stream.record({functional.get_PC(), functional.get_instruction(), 0, 0, 0});
+      stream.finish();
+    });
+  }
+
+  ~FunctionalOracle() {
+    if (producer.joinable()) producer.join();
+  }
+
+  FunctionalOracle(const FunctionalOracle&) = delete;
+  FunctionalOracle& operator=(const FunctionalOracle&) = delete;
+
+  TraceSource* source() {
+    return &stream;
+  }
+
+  // 乱序模型跑完后调用
+  void stop(std::ostream& report) {
+    if (producer.joinable()) producer.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    report << "decoupled: " << stream.get_produced() << " oracle records, timing model waited " << stream.get_waits()
+           << " times, " << seconds << " s" << std::endl;
+  }
+};
@@ -1,9 +1,54 @@
 #include <cstdint>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+// 条件分支的方向预测。taken / not-taken 是静态预测；bimodal 用 PC 索引 2 位饱和计数器，
+// gshare 用全局历史异或 PC 索引。计数器和历史都在分支提交时更新
+enum class PredictorType {
+  TAKEN, NOT_TAKEN, BIMODAL, GSHARE
+};
+
+inline PredictorType parse_predictor_type(const std::string& name) {
+  if (name == "taken") return PredictorType::TAKEN;
+  if (name == "not-taken") return PredictorType::NOT_TAKEN;
+  if (name == "bimodal") return PredictorType::BIMODAL;
+  if (name == "gshare") return PredictorType::GSHARE;
+  throw std::runtime_error("Unknown predictor: " + name);
+}
+
 class Predictor {
+private:
+  PredictorType type = PredictorType::TAKEN;
+  uint32_t mask = 0;
+  uint32_t history = 0;
+  std::vector<uint8_t> counters;
+
+  uint32_t index(uint32_t pc) const {
+    uint32_t i = pc >> 2;
+    if (type == PredictorType::GSHARE) i ^= history;
+    return i & mask;
+  }
+
 public:
   Predictor() = default;
+  Predictor(PredictorType t, uint32_t table_bits = 12)
+      : type(t), mask((1u << table_bits) - 1), counters(1u << table_bits, 2) {}
   ~Predictor() = default;
+
   bool predict(uint32_t pc) {
-    return true;
+    switch (type) {
+      case PredictorType::TAKEN: return true;
+      case PredictorType::NOT_TAKEN: return false;
+      default: return counters[index(pc)] >= 2;
+    }
+  }
+
+  void update(uint32_t pc, bool taken) {
+    if (type != PredictorType::BIMODAL && type != PredictorType::GSHARE) return;
+    uint8_t& c = counters[index(pc)];
+    if (taken && c < 3) c++;
+    if (!taken && c > 0) c--;
+    history = (history << 1) | (taken ? 1 : 0);
   }
-};
\ No newline at end of file
+};
@@ -0,0 +1,208 @@
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <iomanip>
+#include <elf.h>
+
+// 符号表：支持 ELF32 文件中的 .symtab，或 nm 输出格式的文本（"地址 [类型] 名字"）
+class SymbolTable {
+ private:
+  std::vector<std::pair<uint32_t, std::string>> symbols;   // 按地址排序
+
+  bool load_elf(const std::vector<char>& data) {
+    if (data.size() < sizeof(Elf32_Ehdr)) return false;
+    const Elf32_Ehdr* eh = reinterpret_cast<const Elf32_Ehdr*>(data.data());
+    if (eh->e_ident[EI_CLASS] != ELFCLASS32) return false;
+    if (eh->e_shoff + static_cast<uint64_t>(eh->e_shnum) * sizeof(Elf32_Shdr) > data.size()) return false;
+    const Elf32_Shdr* sh = reinterpret_cast<const Elf32_Shdr*>(data.data() + eh->e_shoff);
+    std::vector<std::pair<uint32_t, std::string>> funcs, labels;
+    for (int i = 0; i < eh->e_shnum; ++i) {
+      if (sh[i].sh_type != SHT_SYMTAB || sh[i].sh_link >= eh->e_shnum) continue;
+      const Elf32_Shdr& strtab = sh[sh[i].sh_link];
+      // 越界或字符串表不以 NUL 结尾的节整个跳过
+      if (static_cast<uint64_t>(sh[i].sh_offset) + sh[i].sh_size > data.size()) continue;
+      if (static_cast<uint64_t>(strtab.sh_offset) + strtab.sh_size > data.size()) continue;
+      if (strtab.sh_size == 0 || data[strtab.sh_offset + strtab.sh_size - 1] != '\0') continue;
+      const Elf32_Sym* sym = reinterpret_cast<const Elf32_Sym*>(data.data() + sh[i].sh_offset);
+      size_t count = sh[i].sh_size / sizeof(Elf32_Sym);
+      for (size_t j = 0; j < count; ++j) {
+        if (sym[j].st_shndx == SHN_UNDEF || sym[j].st_name == 0 || sym[j].st_name >= strtab.sh_size) continue;
+        int type = ELF32_ST_TYPE(sym[j].st_info);
+        std::string name(data.data() + strtab.sh_offset + sym[j].st_name);
+        if (type == STT_FUNC) {
+          funcs.push_back({sym[j].st_value, name});
+        } else if (type == STT_NOTYPE) {
+          labels.push_back({sym[j].st_value, name});
+        }
+      }
+    }
+    // 汇编程序通常没有 STT_FUNC，这时退而使用普通标号
+    symbols = funcs.empty() ? labels : funcs;
+    return true;
+  }
+
+  void load_text(std::istream& in) {
+    std::string line;
+    while (std::getline(in, line)) {
+      std::istringstream ss(line);
+      std::string addr, a, b;
+      if (!(ss >> addr >> a)) continue;
+      std::string name = (ss >> b) ? b : a;
+      if (!b.empty() && a.size() == 1 && std::string("TtWw").find(a[0]) == std::string::npos) continue;
+      try {
+        symbols.push_back({static_cast<uint32_t>(std::stoul(addr, nullptr, 16)), name});
+      } catch (const std::exception&) {
+        continue;
+      }
+    }
+  }
+
+ public:
+  bool load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (data.size() >= 4 && data[0] == 0x7f && data[1] == 'E' && data[2] == 'L' && data[3] == 'F') {
+      if (!load_elf(data)) return false;
+    } else {
+      std::istringstream text(std::string(data.begin(), data.end()));
+      load_text(text);
+    }
+    std::sort(symbols.begin(), symbols.end());
+    return true;
+  }
+
+  bool empty() const { return symbols.empty(); }
+
+  // 包含 pc 的符号下标，没有返回 -1
+  int find(uint32_t pc) const {
+    auto it = std::upper_bound(symbols.begin(), symbols.end(), std::make_pair(pc, std::string("\xff")));
+    if (it == symbols.begin()) return -1;
+    return static_cast<int>(it - symbols.begin()) - 1;
+  }
+
+  const std::string& name(int index) const { return symbols[index].second; }
+  uint32_t address(int index) const { return symbols[index].first; }
+  size_t size() const { return symbols.size(); }
+
+  std::string describe(uint32_t pc) const {
+    int i = find(pc);
+    if (i < 0) return "?";
+    uint32_t off = pc - symbols[i].first;
+    return off ? symbols[i].second + "+" + std::to_string(off) : symbols[i].second;
+  }
+};
+
+// 每条指令一个槽，下标为 (pc - base) >> 2
+class Profiler {
+ private:
+  uint32_t base;
+  uint32_t words;
+  std::vector<uint64_t> exec_count;
+  std::vector<uint64_t> block_count;   // 以该 pc 为起点进入基本块的次数
+  std::vector<uint64_t> cycle_count;
+  uint64_t outside = 0;
+  uint64_t total = 0;
+  uint64_t total_cycles = 0;
+  uint32_t last_pc = 0;
+  bool last_control = true;
+
+  static bool is_control(uint32_t code) {
+    uint32_t opcode = code & 0x7F;
+    return opcode == 0b1100011 || opcode == 0b1101111 || opcode == 0b1100111;
+  }
+
+  std::string hex(uint32_t v) const {
+    std::ostringstream ss;
+    ss << "0x" << std::hex << std::setw(8) << std::setfill('0') << v;
+    return ss.str();
+  }
+
+ public:
+  Profiler(uint32_t b, uint32_t end)
+      : base(b & ~3u), words(((end - (b & ~3u)) + 3) >> 2),
+        exec_count(words, 0), block_count(words, 0), cycle_count(words, 0) {}
+
+  void on_execute(uint32_t pc, uint32_t code) {
+    uint32_t idx = (pc - base) >> 2;
+    bool leader = last_control || pc != last_pc + 4;
+    last_pc = pc;
+    last_control = is_control(code);
+    total++;
+    if (idx >= words) {
+      outside++;
+      return;
+    }
+    exec_count[idx]++;
+    if (leader) block_count[idx]++;
+  }
+
+  void add_cycles(uint32_t pc, uint64_t n) {
+    total_cycles += n;
+    uint32_t idx = (pc - base) >> 2;
+    if (idx < words) cycle_count[idx] += n;
+  }
+
+  void report(std::ostream& os, const Memory& mem, const SymbolTable* syms, size_t top = 30) const {
+    bool by_cycles = total_cycles != 0;
+    const std::vector<uint64_t>& key = by_cycles ? cycle_count : exec_count;
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < words; ++i) {
+      if (exec_count[i] || cycle_count[i]) order.push_back(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return key[a] > key[b]; });
+
+    auto pct = [](uint64_t v, uint64_t t) { return t ? 100.0 * v / t : 0.0; };
+    os << std::fixed << std::setprecision(2);
+    os << "# hot spots (" << total << " instructions";
+    if (by_cycles) os << ", " << total_cycles << " cycles";
+    os << ", " << outside << " outside image)\n";
+    os << "pc          execs       %exec";
+    if (by_cycles) os << "   cycles      %cyc";
+    os << "   symbol                disassembly\n";
+    for (size_t n = 0; n < order.size() && n < top; ++n) {
+      uint32_t i = order[n];
+      uint32_t pc = base + (i << 2);
+      os << hex(pc) << "  " << std::setw(10) << exec_count[i] << "  " << std::setw(6) << pct(exec_count[i], total) << "%";
+      if (by_cycles) os << "  " << std::setw(10) << cycle_count[i] << "  " << std::setw(6) << pct(cycle_count[i], total_cycles) << "%";
+      os << "   " << std::left << std::setw(20) << (syms ? syms->describe(pc) : "") << std::right
+         << "  " << disassemble(mem.read_word(pc), pc) << "\n";
+    }
+
+    // 基本块：从入口开始直到下一个跳转或下一个入口
+    std::vector<uint32_t> leaders;
+    for (uint32_t i = 0; i < words; ++i) {
+      if (block_count[i]) leaders.push_back(i);
+    }
+    std::stable_sort(leaders.begin(), leaders.end(), [&](uint32_t a, uint32_t b) {
+      return block_count[a] > block_count[b];
+    });
+    os << "\n# hot basic blocks\nleader      entries     length  symbol\n";
+    for (size_t n = 0; n < leaders.size() && n < top; ++n) {
+      uint32_t i = leaders[n], len = 1;
+      while (i + len < words && !is_control(mem.read_word(base + ((i + len - 1) << 2))) && !block_count[i + len]) len++;
+      os << hex(base + (i << 2)) << "  " << std::setw(10) << block_count[i] << "  " << std::setw(6) << len
+         << "  " << (syms ? syms->describe(base + (i << 2)) : "") << "\n";
+    }
+
+    if (syms != nullptr && !syms->empty()) {
+      os << "\n# annotated disassembly\n";
+      for (size_t s = 0; s < syms->size(); ++s) {
+        uint32_t start = syms->address(s);
+        uint32_t end = (s + 1 < syms->size()) ? syms->address(s + 1) : base + (words << 2);
+        if (start < base || start >= base + (words << 2) || end <= start) continue;
+        os << "\n" << hex(start) << " <" << syms->name(s) << ">:\n";
+        for (uint32_t pc = start; pc < end && ((pc - base) >> 2) < words; pc += 4) {
+          uint32_t i = (pc - base) >> 2;
+          os << std::setw(12) << exec_count[i];
+          if (by_cycles) os << std::setw(12) << cycle_count[i];
+          os << "  " << hex(pc) << ":  " << disassemble(mem.read_word(pc), pc) << "\n";
+        }
+      }
+    }
+    os.unsetf(std::ios::fixed);
+  }
+};
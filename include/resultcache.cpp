@@ -0,0 +1,205 @@
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <sstream>
+#include <fstream>
+#include <ostream>
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <unistd.h>
+
+// 按内容寻址的模拟结果缓存。键是初始内存、寄存器、PC、运行模式、配置和模拟器构建号的哈希，
+// 值是停机状态、返回值、最终寄存器和统计，每个键一个文件。命中时更新文件的修改时间，
+// 目录总大小超过上限时先删修改时间最早的，即 LRU
+
+// 构建号由两部分组成：模拟器核心的（定义在 lib/cpu.cpp，改了 CPU 或它包含的模块就会重新编译）
+// 和包含本文件的驱动翻译单元的编译时间，任何一边重新编译都会换一个构建号
+extern const char SIM_BUILD_ID[];
+
+struct CachedResult {
+  bool halted = false;
+  uint32_t exit_code = 0;
+  uint32_t regs[32] = {};
+  std::vector<std::pair<std::string, uint64_t>> counters;
+  std::string stats;   // print_stats 的输出，功能模型为空
+};
+
+// 所有影响结果的配置参数
+inline std::string config_key(const Cache_Config& l1, const DRAM_Config& dram, const Core_Config& core) {
+  std::ostringstream os;
+  os << "core " << core.rob_size << " " << core.rs_size << " " << core.lsb_size << " " << core.width << " "
+     << static_cast<int>(core.predictor) << "\nl1 " << l1.size << " " << l1.ways << " " << l1.line_size << " "
+     << l1.hit_latency << " " << l1.mshrs << "\ndram " << dram.channels << " " << dram.banks << " " << dram.row_size
+     << " " << dram.line_size << " " << dram.t_row_hit << " " << dram.t_row_miss << " " << dram.t_row_conflict << " "
+     << dram.t_burst << " " << dram.queue_size << " " << dram.open_page << "\n";
+  return os.str();
+}
+
+// 运行结束后的 CPU 状态；counters 取乱序模型的全部计数器，功能模型由调用者填
+inline CachedResult capture_result(const CPU& cpu, bool ooo) {
+  CachedResult r;
+  r.halted = cpu.is_halted();
+  r.exit_code = cpu.get_exit_code();
+  for (uint32_t i = 0; i < 32; ++i) r.regs[i] = cpu.get_register(i);
+  if (ooo) {
+    for (const auto& [name, value] : cpu.get_stats().get_counters()) r.counters.push_back({name, *value});
+    std::ostringstream os;
+    cpu.print_stats(os);
+    r.stats = os.str();
+  }
+  return r;
+}
+
+class ResultCache {
+ private:
+  std::filesystem::path dir;
+  uint64_t max_bytes;
+  std::mutex lock;
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+
+  // 两个不同初值的 64 位 FNV-1a
+  struct Hasher {
+    uint64_t a = 0xcbf29ce484222325ull;
+    uint64_t b = 0x84222325cbf29ce4ull;
+
+    void add(const void* data, size_t n) {
+      const uint8_t* p = static_cast<const uint8_t*>(data);
+      for (size_t i = 0; i < n; ++i) {
+        a = (a ^ p[i]) * 0x100000001b3ull;
+        b = (b ^ p[i]) * 0x100000001b3ull;
+      }
+    }
+
+    void add(uint32_t v) {
+      add(&v, sizeof(v));
+    }
+
+    void add(const std::string& s) {
+      add(s.data(), s.size());
+      add(static_cast<uint32_t>(s.size()));
+    }
+
+    std::string hex() const {
+      char buf[33];
+      std::snprintf(buf, sizeof(buf), "%016llx%016llx", static_cast<unsigned long long>(a),
+                    static_cast<unsigned long long>(b));
+      return buf;
+    }
+  };
+
+  void evict() {
+    std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> files;
+    uint64_t total = 0;
+    std::error_code ec;
+    for (const auto& e : std::filesystem::directory_iterator(dir, ec)) {
+      if (!e.is_regular_file(ec) || e.path().filename().string()[0] == '.') continue;
+      total += e.file_size(ec);
+      files.push_back({e.last_write_time(ec), e.path()});
+    }
+    std::sort(files.begin(), files.end());
+    for (const auto& [time, path] : files) {
+      if (total <= max_bytes) break;
+      uint64_t size = std::filesystem::file_size(path, ec);
+      if (std::filesystem::remove(path, ec)) {
+        total -= size;
+        evictions++;
+      }
+    }
+  }
+
+ public:
+  ResultCache(const std::string& d, uint64_t max) : dir(d), max_bytes(max) {
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (!std::filesystem::is_directory(dir)) throw std::runtime_error("Cannot create result cache: " + d);
+  }
+
+  // 在载入程序之后、开始运行之前计算；全零页与不存在的页读出来一样，不计入
+  std::string key(const CPU& cpu, const std::string& mode, const std::string& config) const {
+    Hasher h;
+    h.add(std::string(SIM_BUILD_ID) + " " __DATE__ " " __TIME__);
+    h.add(mode);
+    h.add(config);
+    ArchState s = cpu.save_state();
+    h.add(s.mem.get_PC());
+    for (uint32_t i = 0; i < 32; ++i) h.add(s.regs.read_unsigned(i));
+    for (uint32_t tag : s.mem.page_numbers()) {
+      const uint8_t* page = s.mem.page_data(tag);
+      if (std::all_of(page, page + PAGE_SIZE, [](uint8_t b) { return b == 0; })) continue;
+      h.add(tag);
+      h.add(page, PAGE_SIZE);
+    }
+    return h.hex();
+  }
+
+  bool lookup(const std::string& key, CachedResult& r) {
+    std::filesystem::path path = dir / key;
+    std::ifstream in(path);
+    std::string magic, field;
+    bool ok = in >> magic && magic == "RVRESULT" && in >> field >> r.halted >> field >> r.exit_code >> field;
+    for (uint32_t i = 0; ok && i < 32; ++i) ok = static_cast<bool>(in >> r.regs[i]);
+    r.counters.clear();
+    while (ok && in >> field && field == "counter") {
+      std::string name;
+      uint64_t value;
+      ok = static_cast<bool>(in >> name >> value);
+      r.counters.push_back({name, value});
+    }
+    size_t length = 0;
+    ok = ok && field == "stats" && in >> length && in.get() == '\n';
+    if (ok) {
+      r.stats.resize(length);
+      ok = static_cast<bool>(in.read(&r.stats[0], length));
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    if (!ok) {
+      misses++;
+      return false;
+    }
+    std::error_code ec;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+    hits++;
+    return true;
+  }
+
+  // 先写临时文件再改名，其他进程不会读到写了一半的结果
+  void store(const std::string& key, const CachedResult& r) {
+    std::ostringstream os;
+    os << "RVRESULT\nhalted " << r.halted << "\nexit " << r.exit_code << "\nregs";
+    for (uint32_t v : r.regs) os << " " << v;
+    os << "\n";
+    for (const auto& [name, value] : r.counters) os << "counter " << name << " " << value << "\n";
+    os << "stats " << r.stats.size() << "\n" << r.stats;
+    std::lock_guard<std::mutex> guard(lock);
+    std::filesystem::path tmp = dir / ("." + key + "." + std::to_string(::getpid()));
+    {
+      std::ofstream out(tmp, std::ios::binary);
+      out << os.str();
+      if (!out) return;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, dir / key, ec);
+    evict();
+  }
+
+  void report(std::ostream& os) {
+    std::lock_guard<std::mutex> guard(lock);
+    uint64_t total = 0, entries = 0;
+    std::error_code ec;
+    for (const auto& e : std::filesystem::directory_iterator(dir, ec)) {
+      if (!e.is_regular_file(ec) || e.path().filename().string()[0] == '.') continue;
+      total += e.file_size(ec);
+      entries++;
+    }
+    uint64_t lookups = hits + misses;
+    os << "result cache: " << hits << " hits, " << misses << " misses";
+    if (lookups != 0) os << " (" << 100 * hits / lookups << "% hit)";
+    os << ", " << evictions << " evicted, " << entries << " entries, " << total << " / " << max_bytes << " bytes"
+       << std::endl;
+  }
+};
@@ -0,0 +1,44 @@
+#include <cstdint>
+#include <vector>
+#include <atomic>
+#include <thread>
+
+// 单生产者单消费者的无锁环形缓冲区，容量为 2 的幂
+template <typename T>
+class SpscRing {
+ private:
+  std::vector<T> slots;
+  uint64_t mask;
+  alignas(64) std::atomic<uint64_t> head{0};   // 生产者写入位置
+  alignas(64) std::atomic<uint64_t> tail{0};   // 消费者读取位置
+
+ public:
+  SpscRing(uint32_t log2_size) : slots(1ull << log2_size), mask((1ull << log2_size) - 1) {}
+
+  SpscRing(const SpscRing&) = delete;
+  SpscRing& operator=(const SpscRing&) = delete;
+
+  // 只在生产者线程调用；满时让出 CPU 等消费者腾出空间
+  void push(const T& v) {
+    uint64_t h = head.load(std::memory_order_relaxed);
+    while (h - tail.load(std::memory_order_acquire) > mask) {
+      std::this_thread::yield();
+    }
+    slots[h & mask] = v;
+    head.store(h + 1, std::memory_order_release);
+  }
+
+  // 只在消费者线程调用；把当前所有元素交给 f，返回取出的个数
+  template <typename F>
+  uint64_t drain(F&& f) {
+    uint64_t t = tail.load(std::memory_order_relaxed);
+    uint64_t h = head.load(std::memory_order_acquire);
+    uint64_t n = h - t;
+    while (t != h) {
+      f(slots[t & mask]);
+      ++t;
+    }
+    tail.store(t, std::memory_order_release);
+    return n;
+  }
+};
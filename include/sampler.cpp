@@ -0,0 +1,87 @@
+#include <cstdint>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include "ring.cpp"
+
+// 区间采样：模拟线程把计数器快照写进预分配的环形缓冲区，
+// 后台线程取出后计算区间增量并写入 CSV（.bin 结尾则直接写二进制快照）
+
+struct Sample {
+  uint64_t cycle;
+  uint64_t instret;
+  uint64_t mispredicts;
+  uint64_t l1_accesses;
+  uint64_t l1_misses;
+  uint32_t rob_occupancy;
+  uint32_t lsb_occupancy;
+};
+
+class IntervalSampler {
+ private:
+  SpscRing<Sample> ring{14};
+  std::atomic<bool> stopping{false};
+  std::thread writer;
+  std::ofstream out;
+  bool binary = false;
+  Sample last{};
+
+  void write_sample(const Sample& s) {
+    if (binary) {
+      out.write(reinterpret_cast<const char*>(&s), sizeof(Sample));
+      return;
+    }
+    uint64_t d_cycle = s.cycle - last.cycle;
+    uint64_t d_inst = s.instret - last.instret;
+    uint64_t d_acc = s.l1_accesses - last.l1_accesses;
+    double ipc = d_cycle ? static_cast<double>(d_inst) / d_cycle : 0.0;
+    double mpki = d_inst ? (s.mispredicts - last.mispredicts) * 1000.0 / d_inst : 0.0;
+    double miss_rate = d_acc ? static_cast<double>(s.l1_misses - last.l1_misses) / d_acc : 0.0;
+    out << s.cycle << ',' << s.instret << ',' << ipc << ',' << mpki << ','
+        << miss_rate << ',' << s.rob_occupancy << ',' << s.lsb_occupancy << '\n';
+    last = s;
+  }
+
+  void drain() {
+    ring.drain([this](const Sample& s) { write_sample(s); });
+  }
+
+  void writer_loop() {
+    while (!stopping.load(std::memory_order_acquire)) {
+      drain();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    drain();
+    out.flush();
+  }
+
+ public:
+  IntervalSampler(const std::string& path) : out(path, std::ios::binary) {
+    binary = path.size() >= 4 && path.compare(path.size() - 4, 4, ".bin") == 0;
+    if (!binary) {
+      out << "cycle,instructions,ipc,branch_mpki,l1d_miss_rate,rob_occupancy,lsb_occupancy\n";
+    }
+    writer = std::thread(&IntervalSampler::writer_loop, this);
+  }
+
+  ~IntervalSampler() {
+    stop();
+  }
+
+  IntervalSampler(const IntervalSampler&) = delete;
+  IntervalSampler& operator=(const IntervalSampler&) = delete;
+
+  // 只在模拟线程调用
+  void record(const Sample& s) {
+    ring.push(s);
+  }
+
+  void stop() {
+    if (!writer.joinable()) return;
+    stopping.store(true, std::memory_order_release);
+    writer.join();
+  }
+};
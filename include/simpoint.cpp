@@ -0,0 +1,388 @@
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <unordered_map>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <iomanip>
+#include <ostream>
+
+// SimPoint 式抽样模拟：
+// 1. 功能模型全速运行，按固定指令数切分区间，收集每个区间的基本块向量（BBV）；
+// 2. BBV 随机投影到低维后做 k-means，k 用 BIC 选取；
+// 3. 每个簇取离中心最近的区间以及若干随机区间，功能快进到区间前，
+//    先功能预热 L1，再用乱序模型精确模拟该区间；
+// 4. 各簇的 CPI 按指令数加权，误差按分层抽样估计
+
+struct SimPointConfig {
+  uint64_t interval = 100000;   // 区间长度（指令数）
+  uint32_t max_k = 10;
+  uint64_t warmup = 0;          // 预热指令数，0 表示与区间等长
+  uint32_t samples = 2;         // 每个簇精确模拟的区间数
+  uint32_t seed = 1;
+};
+
+// 按区间收集基本块向量，块以入口 PC 区分，值为块内执行的指令数
+class BbvCollector : public TraceSink {
+ private:
+  uint64_t interval;
+  std::unordered_map<uint32_t, uint32_t> block_ids;
+  std::unordered_map<uint32_t, uint64_t> current;
+  std::vector<std::vector<std::pair<uint32_t, uint64_t>>> bbvs;
+  std::vector<uint64_t> lengths;
+  uint32_t block = 0;
+  uint64_t block_len = 0;
+  uint64_t in_interval = 0;
+  uint32_t last_pc = 0;
+  bool last_control = true;
+
+  void close_block() {
+    if (block_len != 0) current[block] += block_len;
+    block_len = 0;
+  }
+
+  void close_interval() {
+    close_block();
+    bbvs.emplace_back(current.begin(), current.end());
+    lengths.push_back(in_interval);
+    current.clear();
+    in_interval = 0;
+  }
+
+ public:
+  BbvCollector(uint64_t n) : interval(n) {}
+
+  void record(const TraceRecord& r) override {
+    if (last_control || r.pc != last_pc + 4) {
+      close_block();
+      block = block_ids.emplace(r.pc, static_cast<uint32_t>(block_ids.size())).first->second;
+    }
+    uint32_t opcode = r.inst & 0x7F;
+    last_control = opcode == 0b1100011 || opcode == 0b1101111 || opcode == 0b1100111;
+    last_pc = r.pc;
+    block_len++;
+    if (++in_interval == interval) close_interval();
+  }
+
+  void finish() {
+    if (in_interval != 0) close_interval();
+  }
+
+  const std::vector<std::vector<std::pair<uint32_t, uint64_t>>>& get_bbvs() const { return bbvs; }
+  const std::vector<uint64_t>& get_lengths() const { return lengths; }
+  size_t num_blocks() const { return block_ids.size(); }
+};
+
+// 预热阶段：功能模型的每次访存都访问一次 L1，每个条件分支的结果都训练一次预测器。
+// 分支的结果等下一条记录到来时才知道，预热结束时用 finish 给出下一条 PC
+class WarmupSink : public TraceSink {
+ private:
+  CPU& cpu;
+  bool pending = false;
+  uint32_t branch_pc = 0;
+
+  void resolve(uint32_t next_pc) {
+    if (pending) cpu.warm_branch(branch_pc, next_pc != branch_pc + 4);
+    pending = false;
+  }
+
+ public:
+  WarmupSink(CPU& c) : cpu(c) {}
+  void record(const TraceRecord& r) override {
+    resolve(r.pc);
+    if (trace_is_memory(r.inst)) cpu.warm_memory(r.mem_addr, (r.inst & 0x7F) == 0b0100011);
+    if (trace_is_branch(r.inst)) {
+      pending = true;
+      branch_pc = r.pc;
+    }
+  }
+
+  void finish(uint32_t next_pc) {
+    resolve(next_pc);
+  }
+};
+
+struct KMeansResult {
+  std::vector<uint32_t> assign;
+  std::vector<std::vector<double>> centers;
+  double sse = 0;
+  double bic = 0;
+};
+
+class SimPoint {
+ private:
+  static constexpr uint32_t DIMS = 15;
+
+  static uint64_t mix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+  }
+
+  static double dist2(const std::vector<double>& a, const std::vector<double>& b) {
+    double d = 0;
+    for (size_t i = 0; i < a.size(); ++i) d += (a[i] - b[i]) * (a[i] - b[i]);
+    return d;
+  }
+
+  // 每个基本块对应一个 [-1, 1] 上的随机向量，由块编号确定
+  static std::vector<std::vector<double>> project(const BbvCollector& bbv, uint32_t seed) {
+    std::vector<std::vector<double>> points;
+    for (size_t i = 0; i < bbv.get_bbvs().size(); ++i) {
+      std::vector<double> p(DIMS, 0.0);
+      double total = static_cast<double>(bbv.get_lengths()[i]);
+      for (const auto& [block, count] : bbv.get_bbvs()[i]) {
+        for (uint32_t d = 0; d < DIMS; ++d) {
+          uint64_t h = mix((static_cast<uint64_t>(seed) << 40) ^ (static_cast<uint64_t>(block) * DIMS + d));
+          p[d] += (count / total) * (static_cast<double>(h >> 11) / (1ull << 52) - 1.0);
+        }
+      }
+      points.push_back(std::move(p));
+    }
+    return points;
+  }
+
+  static KMeansResult kmeans(const std::vector<std::vector<double>>& pts, uint32_t k, std::mt19937_64& rng) {
+    KMeansResult r;
+    size_t n = pts.size();
+    // k-means++ 选初始中心
+    r.centers.push_back(pts[rng() % n]);
+    std::vector<double> d(n);
+    while (r.centers.size() < k) {
+      double sum = 0;
+      for (size_t i = 0; i < n; ++i) {
+        d[i] = dist2(pts[i], r.centers[0]);
+        for (const auto& c : r.centers) d[i] = std::min(d[i], dist2(pts[i], c));
+        sum += d[i];
+      }
+      if (sum == 0) break;
+      double target = std::uniform_real_distribution<double>(0, sum)(rng);
+      size_t pick = 0;
+      for (double acc = d[0]; acc < target && pick + 1 < n; acc += d[++pick]) {}
+      r.centers.push_back(pts[pick]);
+    }
+    k = static_cast<uint32_t>(r.centers.size());
+    r.assign.assign(n, 0);
+    for (int iter = 0; iter < 100; ++iter) {
+      bool changed = iter == 0;
+      for (size_t i = 0; i < n; ++i) {
+        uint32_t best = 0;
+        for (uint32_t c = 1; c < k; ++c) {
+          if (dist2(pts[i], r.centers[c]) < dist2(pts[i], r.centers[best])) best = c;
+        }
+        if (best != r.assign[i]) changed = true;
+        r.assign[i] = best;
+      }
+      if (!changed) break;
+      std::vector<std::vector<double>> sum(k, std::vector<double>(DIMS, 0.0));
+      std::vector<uint32_t> cnt(k, 0);
+      for (size_t i = 0; i < n; ++i) {
+        cnt[r.assign[i]]++;
+        for (uint32_t j = 0; j < DIMS; ++j) sum[r.assign[i]][j] += pts[i][j];
+      }
+      for (uint32_t c = 0; c < k; ++c) {
+        if (cnt[c] == 0) continue;
+        for (uint32_t j = 0; j < DIMS; ++j) r.centers[c][j] = sum[c][j] / cnt[c];
+      }
+    }
+    std::vector<uint32_t> cnt(k, 0);
+    for (size_t i = 0; i < n; ++i) {
+      cnt[r.assign[i]]++;
+      r.sse += dist2(pts[i], r.centers[r.assign[i]]);
+    }
+    // 球形高斯模型下的 BIC（X-means）
+    double R = static_cast<double>(n);
+    double var = (n > k) ? r.sse / (DIMS * (R - k)) : 0.0;
+    var = std::max(var, 1e-12);
+    double ll = 0;
+    for (uint32_t c = 0; c < k; ++c) {
+      if (cnt[c] != 0) ll += cnt[c] * std::log(cnt[c] / R);
+    }
+    ll -= R * DIMS / 2.0 * std::log(2 * M_PI * var) + r.sse / (2 * var);
+    double params = (k - 1) + static_cast<double>(k) * DIMS + 1;
+    r.bic = ll - params / 2.0 * std::log(R);
+    return r;
+  }
+
+  // k 从 1 到 max_k，取 BIC 达到最好值 90% 的最小 k；每个 k 取多次随机初始化中 SSE 最小的一次
+  static KMeansResult cluster(const std::vector<std::vector<double>>& pts, uint32_t max_k, uint32_t seed) {
+    std::mt19937_64 rng(seed);
+    std::vector<KMeansResult> results;
+    uint32_t limit = std::min<uint32_t>(max_k, static_cast<uint32_t>(pts.size()));
+    for (uint32_t k = 1; k <= limit; ++k) {
+      KMeansResult best;
+      for (int t = 0; t < 5; ++t) {
+        KMeansResult r = kmeans(pts, k, rng);
+        if (t == 0 || r.sse < best.sse) best = std::move(r);
+      }
+      results.push_back(std::move(best));
+    }
+    double lo = results[0].bic, hi = results[0].bic;
+    for (const auto& r : results) {
+      lo = std::min(lo, r.bic);
+      hi = std::max(hi, r.bic);
+    }
+    for (auto& r : results) {
+      if (r.bic >= lo + 0.9 * (hi - lo)) return r;
+    }
+    return results.back();
+  }
+
+ public:
+  static void run(const std::string& image, const Cache_Config& l1, const DRAM_Config& dram, const Core_Config& core,
+                  const SimPointConfig& config, bool skip_idle, std::ostream& os) {
+    using clock = std::chrono::steady_clock;
+    auto seconds = [](clock::time_point a, clock::time_point b) {
+      return std::chrono::duration<double>(b - a).count();
+    };
+
+    // 第一遍：功能运行并收集 BBV
+    auto t0 = clock::now();
+    BbvCollector bbv(config.interval);
+    {
+      CPU cpu(l1, dram, core);
+      std::istringstream in(image);
+      uint32_t lo, hi;
+      load_image(cpu, in, lo, hi);
+      cpu.cpu_set_PC(0x0);
+      cpu.set_tracer(&bbv);
+      cpu.run_functional();
+      bbv.finish();
+    }
+    const auto& lengths = bbv.get_lengths();
+    if (lengths.empty()) return;
+    uint64_t total = 0;
+    for (uint64_t l : lengths) total += l;
+
+    // 聚类并选出要精确模拟的区间
+    auto t1 = clock::now();
+    auto points = project(bbv, config.seed);
+    KMeansResult km = cluster(points, config.max_k, config.seed);
+    uint32_t k = static_cast<uint32_t>(km.centers.size());
+    std::vector<std::vector<uint32_t>> members(k);
+    for (uint32_t i = 0; i < km.assign.size(); ++i) members[km.assign[i]].push_back(i);
+    std::vector<std::vector<uint32_t>> picked(k);
+    std::mt19937_64 rng(config.seed + 1);
+    for (uint32_t c = 0; c < k; ++c) {
+      if (members[c].empty()) continue;
+      std::vector<uint32_t> order = members[c];
+      uint32_t rep = *std::min_element(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return dist2(points[a], km.centers[c]) < dist2(points[b], km.centers[c]);
+      });
+      picked[c].push_back(rep);
+      order.erase(std::find(order.begin(), order.end(), rep));
+      std::shuffle(order.begin(), order.end(), rng);
+      for (size_t j = 0; j < order.size() && picked[c].size() < config.samples; ++j) {
+        picked[c].push_back(order[j]);
+      }
+    }
+    std::vector<std::pair<uint32_t, uint32_t>> schedule;   // (区间, 簇)
+    for (uint32_t c = 0; c < k; ++c) {
+      for (uint32_t i : picked[c]) schedule.push_back({i, c});
+    }
+    std::sort(schedule.begin(), schedule.end());
+
+    // 第二遍：快进、预热、精确模拟，区间按先后顺序处理
+    auto t2 = clock::now();
+    uint64_t warmup = config.warmup ? config.warmup : config.interval;
+    std::vector<double> cpi(lengths.size(), 0.0);
+    uint64_t detailed = 0;
+    {
+      CPU cpu(l1, dram, core);
+      std::istringstream in(image);
+      uint32_t lo, hi;
+      load_image(cpu, in, lo, hi);
+      cpu.cpu_set_PC(0x0);
+      WarmupSink warm(cpu);
+      uint64_t pos = 0;
+      for (const auto& [i, c] : schedule) {
+        uint64_t start = i * config.interval;
+        uint64_t warm_from = start > warmup ? start - warmup : 0;
+        if (warm_from > pos) cpu.run_functional(warm_from - pos);
+        pos = std::max(pos, warm_from);
+        cpu.set_tracer(&warm);
+        cpu.run_functional(start - pos);
+        cpu.set_tracer(nullptr);
+        warm.finish(cpu.get_PC());
+        uint64_t cycles = cpu.get_cycle(), insts = cpu.get_instret();
+        cpu.run(skip_idle, lengths[i]);
+        cycles = cpu.get_cycle() - cycles;
+        insts = cpu.get_instret() - insts;
+        cpu.leave_detailed();
+        cpi[i] = insts ? static_cast<double>(cycles) / insts : 0.0;
+        detailed += insts;
+        pos = start + insts;
+      }
+    }
+    auto t3 = clock::now();
+
+    // 分层抽样：每个簇是一层，层权重为簇内指令数占比。
+    // 置信区间只反映抽样误差，不包含预热不足带来的偏差
+    double estimate = 0, variance = 0;
+    double cv2_sum = 0;
+    uint32_t cv2_count = 0;
+    std::vector<double> mean(k, 0.0), var(k, -1.0), weight(k, 0.0);
+    for (uint32_t c = 0; c < k; ++c) {
+      for (uint32_t i : members[c]) weight[c] += static_cast<double>(lengths[i]) / total;
+      if (picked[c].empty()) continue;
+      for (uint32_t i : picked[c]) mean[c] += cpi[i] / picked[c].size();
+      if (picked[c].size() >= 2) {
+        double s2 = 0;
+        for (uint32_t i : picked[c]) s2 += (cpi[i] - mean[c]) * (cpi[i] - mean[c]);
+        var[c] = s2 / (picked[c].size() - 1);
+        if (mean[c] > 0) {
+          cv2_sum += var[c] / (mean[c] * mean[c]);
+          cv2_count++;
+        }
+      }
+      estimate += weight[c] * mean[c];
+    }
+    bool bounded = true;
+    for (uint32_t c = 0; c < k; ++c) {
+      double n = static_cast<double>(picked[c].size()), N = static_cast<double>(members[c].size());
+      if (n == 0 || n == N) continue;
+      double v = var[c];
+      if (v < 0) {
+        // 只模拟了一个区间的簇，借用其他簇的变异系数
+        if (cv2_count == 0) {
+          bounded = false;
+          continue;
+        }
+        v = cv2_sum / cv2_count * mean[c] * mean[c];
+      }
+      variance += weight[c] * weight[c] * v / n * (1 - n / N);
+    }
+    double bound = 1.96 * std::sqrt(variance);
+
+    os << std::fixed << std::setprecision(4);
+    os << "# simpoint: " << lengths.size() << " intervals of " << config.interval << " instructions, "
+       << bbv.num_blocks() << " basic blocks, k = " << k << "\n"
+       << "cluster   weight  intervals  simulated             cpi\n";
+    for (uint32_t c = 0; c < k; ++c) {
+      os << std::setw(7) << c << "  " << std::setw(7) << weight[c] << "  " << std::setw(9) << members[c].size()
+         << "  ";
+      std::string sims;
+      for (uint32_t i : picked[c]) sims += (sims.empty() ? "" : ",") + std::to_string(i);
+      os << std::left << std::setw(16) << sims << std::right << "  " << std::setw(8) << mean[c] << "\n";
+    }
+    os << "instructions " << total << "\n"
+       << "detailed_instructions " << detailed << " (" << std::setprecision(2)
+       << 100.0 * detailed / total << "%)\n" << std::setprecision(4)
+       << "estimated_cpi " << estimate << "\n";
+    if (bounded) {
+      os << "cpi_95ci +-" << bound << " (" << std::setprecision(2)
+         << (estimate > 0 ? 100.0 * bound / estimate : 0.0) << "%)\n";
+    } else {
+      os << "cpi_95ci unknown (use --simpoint-samples >= 2)\n";
+    }
+    os << std::setprecision(3)
+       << "time.profile " << seconds(t0, t1) << "s\n"
+       << "time.cluster " << seconds(t1, t2) << "s\n"
+       << "time.simulate " << seconds(t2, t3) << "s\n";
+    os.unsetf(std::ios::fixed);
+  }
+};
@@ -0,0 +1,386 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <algorithm>
+#include <stdexcept>
+
+// 同时多线程（SMT）：几个硬件线程各有自己的 PC、寄存器重命名表和内存，
+// 共用 ROB、RS、LSB、ALU、分支预测器和 L1/DRAM。每个线程跑一个独立的程序。
+// ROB 按线程分成几段环形队列：静态划分时每个线程固定 rob_size / 线程数 项，
+// 动态划分时各线程不设上限，只限制总数为 rob_size。线程的 ROB 编号加上线程号 * rob_size
+// 作为 RS/LSB 里的标签，一个线程预测错误时只冲刷它自己的指令
+
+enum class FetchPolicy {
+  ROUND_ROBIN, ICOUNT
+};
+
+inline FetchPolicy parse_fetch_policy(const std::string& name) {
+  if (name == "round-robin") return FetchPolicy::ROUND_ROBIN;
+  if (name == "icount") return FetchPolicy::ICOUNT;
+  throw std::runtime_error("Unknown fetch policy: " + name);
+}
+
+struct SMT_Config {
+  FetchPolicy fetch = FetchPolicy::ICOUNT;
+  bool dynamic_rob = true;
+};
+
+struct SMTThreadResult {
+  std::string label;
+  bool halted = false;
+  uint32_t exit_code = 0;
+  uint64_t instructions = 0;
+  uint64_t cycles = 0;   // 停机时的周期
+  uint64_t mispredicts = 0;
+};
+
+class SMTCore {
+ private:
+  struct Thread {
+    std::string label;
+    Memory mem;
+    RegisterFile regs;
+    ROB rob;
+    bool halted = false;
+    bool fetch_stopped = false;   // 取到了停机指令，冲刷后恢复取指
+    uint32_t icount = 0;          // 在 RS 和 LSB 里的指令数
+    uint64_t instret = 0;
+    uint64_t mispredicts = 0;
+    uint64_t finish = 0;
+
+    Thread(const std::string& l, const ArchState& s, uint32_t rob_capacity)
+        : label(l), mem(s.mem), regs(s.regs), rob(rob_capacity) {}
+  };
+
+  std::vector<Thread> threads;
+  ReservationStation RS;
+  LoadStoreBuffer LSB;
+  ALU alu;
+  Predictor predictor;
+  MemSystem ms;
+  EventQueue events;
+  uint32_t width;
+  uint32_t rob_size;
+  SMT_Config smt;
+  uint64_t cycle = 0;
+  uint32_t rr = 0;         // 轮转的起始线程
+  uint32_t rob_used = 0;   // 所有线程占用的 ROB 项数
+  std::vector<uint64_t> mem_done;
+  std::vector<std::pair<uint32_t, uint32_t>> exec_done;
+  std::vector<uint32_t> order;
+
+  uint32_t thread_of(uint32_t id) const {
+    return id / rob_size;
+  }
+
+  ROB_Entry& entry(uint32_t id) {
+    return threads[id / rob_size].rob.get_entry(id % rob_size);
+  }
+
+  void write_result(uint32_t id, uint32_t value) {
+    threads[id / rob_size].rob.write_result(id % rob_size, value);
+  }
+
+  void read_operand(Thread& t, uint32_t r, uint32_t& V, uint32_t& Q) {
+    V = 0;
+    Q = 0;
+    if (!t.regs.is_pending(r)) {
+      V = t.regs.read_unsigned(r);
+      return;
+    }
+    int id = t.regs.get_reorder(r);
+    ROB_Entry& e = entry(id);
+    if (e.state == ROB_State::WRITE_RESULT) {
+      V = e.value;
+    } else {
+      Q = id + 1;
+    }
+  }
+
+  void broadcast(uint32_t id, uint32_t value) {
+    RS.update_operand(id, value);
+    LSB.update_operand(id, value);
+  }
+
+  void flush_thread(uint32_t tid, uint32_t correct_pc) {
+    Thread& t = threads[tid];
+    rob_used -= t.rob.get_size();
+    t.rob.flush();
+    RS.flush_if([this, tid](const RS_Entry& e) { return thread_of(e.ROB_ID) == tid; });
+    LSB.flush_if([tid](const LSB_Entry& e) { return e.thread == tid; });
+    t.icount = 0;
+    t.regs.reset();
+    t.mem.set_PC(correct_pc);
+    t.fetch_stopped = false;
+  }
+
+  bool commit_one(uint32_t tid) {
+    Thread& t = threads[tid];
+    if (t.halted || t.rob.is_empty()) return false;
+    ROB_Entry& head = t.rob.front();
+    if (head.instruction == HALT_INSTRUCTION || head.pc == 8) {
+      flush_thread(tid, head.pc);
+      t.halted = true;
+      t.finish = cycle;
+      return true;
+    }
+    if (head.unsupported) throw std::runtime_error("RV32A is only supported by the functional model");
+    if (head.state != ROB_State::WRITE_RESULT) return false;
+    uint32_t gid = tid * rob_size + head.ID;
+    LSB_Entry* store = LSB.find(gid);
+    if (store != nullptr) {
+      if (!ms.store(store->cache_addr(), cycle)) return false;
+      LSB.write_store(*store, t.mem);
+      LSB.remove(gid);
+      t.icount--;
+    }
+    uint32_t correct_pc;
+    bool mispredict = t.rob.check_mispredict(correct_pc);
+    if ((head.instruction & 0x7F) == 0b1100011) predictor.update(head.pc, head.is_taken);
+    auto [rob_id, value, dest] = t.rob.commit();
+    rob_used--;
+    if (dest != 0) {
+      t.regs.set(dest, value);
+      if (t.regs.get_reorder(dest) == static_cast<int>(tid * rob_size + rob_id)) t.regs.clear_reorder(dest);
+    }
+    t.instret++;
+    if (mispredict) {
+      t.mispredicts++;
+      flush_thread(tid, correct_pc);
+    }
+    return true;
+  }
+
+  // 每周期最多提交 width 条，从轮转到的线程开始
+  bool commit_stage() {
+    bool progress = false;
+    uint32_t slots = width;
+    for (uint32_t i = 0; i < threads.size() && slots > 0; ++i) {
+      uint32_t tid = (rr + i) % threads.size();
+      while (slots > 0 && commit_one(tid)) {
+        slots--;
+        progress = true;
+      }
+    }
+    return progress;
+  }
+
+  bool memory_stage() {
+    mem_done.clear();
+    bool progress = ms.tick(cycle, mem_done);
+    for (uint64_t seq : mem_done) {
+      uint32_t id = 0, value = 0;
+      bool found = LSB.complete(seq, [&](const LSB_Entry& e) {
+        Thread& t = threads[e.thread];
+        id = e.ROB_ID;
+        value = LSB.load_value(e, t.mem);
+        entry(id).mem_addr = e.addr;
+        write_result(id, value);
+        t.icount--;
+      });
+      if (found) broadcast(id, value);
+    }
+    if (LSB.run(ms, [this](uint32_t id) { write_result(id, 0); }, cycle)) progress = true;
+    return progress;
+  }
+
+  bool execute_stage() {
+    exec_done.clear();
+    uint32_t n = 0;
+    for (; n < width; ++n) {
+      auto ready = RS.get_ready_entry();
+      if (!ready.has_value()) break;
+      RS_Entry& e = ready.value();
+      Instruction inst(e.instruction);
+      ALU_Result res = alu.execute(inst, e.pc, e.Vj, e.Vk, e.A);
+      threads[thread_of(e.ROB_ID)].rob.write_result(e.ROB_ID % rob_size, res.value, res.next_pc);
+      RS.remove(e.ROB_ID);
+      threads[thread_of(e.ROB_ID)].icount--;
+      exec_done.push_back({e.ROB_ID, res.value});
+    }
+    for (auto [id, value] : exec_done) broadcast(id, value);
+    return n > 0;
+  }
+
+  bool issue(uint32_t tid) {
+    Thread& t = threads[tid];
+    if (t.halted || t.fetch_stopped || t.rob.is_full() || rob_used >= rob_size) return false;
+    uint32_t pc = t.mem.get_PC();
+    Instruction inst(t.mem.read_word(pc));
+    std::string op = inst.get_op();
+    bool atomic = inst.get_type() == 'A' && op != "no instruction";
+    bool memory_op = !atomic && ::is_memory(op);
+    if (memory_op ? LSB.is_full() : RS.is_full()) return false;
+
+    uint32_t next_pc = pc + 4;
+    bool branch = is_branch(op);
+    if (op == "jal") {
+      next_pc = pc + inst.get_jal_imm();
+    } else if (branch && op != "jalr" && predictor.predict(pc)) {
+      next_pc = pc + inst.get_b_imm();
+    }
+
+    uint32_t Vj = 0, Vk = 0, Qj = 0, Qk = 0;
+    if (has_rs1(op)) read_operand(t, inst.get_rs1(), Vj, Qj);
+    if (has_rs2(op)) read_operand(t, inst.get_rs2(), Vk, Qk);
+
+    bool valid = op != "no instruction";
+    uint32_t dest = (valid && !atomic && has_dest(op)) ? inst.get_rd() : 0;
+    int local = t.rob.allocate(inst.code, dest, branch, false, next_pc != pc + 4, next_pc, pc);
+    rob_used++;
+    uint32_t gid = tid * rob_size + local;
+    if (dest != 0) t.regs.set_reorder(dest, gid);
+    if (!valid) {
+      t.rob.write_result(local, 0);
+    } else if (atomic) {
+      t.rob.get_entry(local).unsupported = true;
+      t.rob.write_result(local, 0);
+    } else if (memory_op) {
+      LSB_Entry e(LoadStoreBuffer::to_lsb_op(op), gid, Vj, Qj, inst.get_imm(), inst.code, Vk, Qk);
+      e.thread = tid;
+      LSB.insert(e);
+      t.icount++;
+    } else {
+      RS.insert(RS_Entry(inst.code, true, Vj, Vk, Qj, Qk, gid, inst.get_imm(), pc));
+      t.icount++;
+    }
+    if (inst.code == HALT_INSTRUCTION || pc == 8) t.fetch_stopped = true;
+    t.mem.set_PC(next_pc);
+    return true;
+  }
+
+  // 每个发射槽按取指策略给线程排序，取第一个能发射的线程的一条指令。
+  // round-robin 从轮转到的线程开始；ICOUNT 优先 RS/LSB 里指令最少的线程
+  bool issue_stage() {
+    uint32_t n = 0;
+    uint32_t count = threads.size();
+    order.resize(count);
+    for (; n < width; ++n) {
+      for (uint32_t i = 0; i < count; ++i) order[i] = (rr + i) % count;
+      if (smt.fetch == FetchPolicy::ICOUNT) {
+        std::stable_sort(order.begin(), order.end(),
+                         [this](uint32_t a, uint32_t b) { return threads[a].icount < threads[b].icount; });
+      }
+      bool issued = false;
+      for (uint32_t tid : order) {
+        if (issue(tid)) {
+          issued = true;
+          break;
+        }
+      }
+      if (!issued) break;
+    }
+    return n > 0;
+  }
+
+  bool all_halted() const {
+    for (const auto& t : threads) {
+      if (!t.halted) return false;
+    }
+    return true;
+  }
+
+  bool tick() {
+    bool progress = commit_stage();
+    if (all_halted()) return true;
+    if (memory_stage()) progress = true;
+    if (execute_stage()) progress = true;
+    if (issue_stage()) progress = true;
+    rr = (rr + 1) % threads.size();
+    cycle++;
+    return progress;
+  }
+
+ public:
+  // 每个程序一个线程，都从 PC 0 开始
+  SMTCore(const std::vector<BatchJob>& jobs, const Cache_Config& l1, const DRAM_Config& dram,
+          const Core_Config& core, const SMT_Config& s)
+      : RS(core.rs_size), LSB(core.lsb_size), predictor(core.predictor), ms(l1, dram), width(core.width),
+        rob_size(core.rob_size), smt(s) {
+    if (jobs.empty()) throw std::runtime_error("SMT manifest lists no program");
+    uint32_t capacity = smt.dynamic_rob ? rob_size : rob_size / jobs.size();
+    if (capacity == 0) throw std::runtime_error("ROB is smaller than the number of threads");
+    ms.set_events(&events);
+    threads.reserve(jobs.size());
+    for (const auto& job : jobs) {
+      std::ifstream in(job.path);
+      if (!in) throw std::runtime_error("Cannot open " + job.path);
+      CPU loader;
+      uint32_t lo, hi;
+      load_image(loader, in, lo, hi);
+      loader.cpu_set_PC(0x0);
+      threads.emplace_back(job.label, loader.save_state(), capacity);
+    }
+  }
+
+  // 运行到所有线程停机，空转周期的跳过方式与 CPU::run 相同
+  void run(bool skip_idle = true) {
+    while (!all_halted()) {
+      if (tick() || !skip_idle) continue;
+      uint64_t next;
+      if (events.next(cycle, next)) cycle = next;
+    }
+  }
+
+  uint64_t get_cycle() const {
+    return cycle;
+  }
+
+  std::vector<SMTThreadResult> results() const {
+    std::vector<SMTThreadResult> r;
+    for (const auto& t : threads) {
+      r.push_back({t.label, t.halted, t.regs.read_unsigned(10) & 0xFF, t.instret, t.finish, t.mispredicts});
+    }
+    return r;
+  }
+
+  // 同样的程序各自单独在同配置的核上运行，作为比较的基准
+  static std::vector<SMTThreadResult> run_alone(const std::vector<BatchJob>& jobs, const Cache_Config& l1,
+                                                const DRAM_Config& dram, const Core_Config& core, bool skip_idle) {
+    std::vector<SMTThreadResult> r;
+    for (const auto& job : jobs) {
+      std::ifstream in(job.path);
+      if (!in) throw std::runtime_error("Cannot open " + job.path);
+      CPU cpu(l1, dram, core);
+      cpu.set_output(nullptr);
+      uint32_t lo, hi;
+      load_image(cpu, in, lo, hi);
+      cpu.cpu_set_PC(0x0);
+      cpu.run(skip_idle);
+      r.push_back({job.label, cpu.is_halted(), cpu.get_exit_code(), cpu.get_instret(), cpu.get_cycle(), 0});
+    }
+    return r;
+  }
+
+  // 每个线程的吞吐，合计吞吐，以及和每个程序单独在同一个核上运行相比的加权加速比
+  static void report(std::ostream& os, const std::vector<SMTThreadResult>& smt, uint64_t cycles,
+                     const std::vector<SMTThreadResult>& alone) {
+    os << std::left << std::setw(8) << "thread" << std::setw(8) << "output" << std::right << std::setw(12)
+       << "insts" << std::setw(12) << "cycles" << std::setw(8) << "ipc" << std::setw(12) << "alone_ipc"
+       << std::setw(10) << "relative" << "  program\n";
+    uint64_t insts = 0, serial = 0;
+    double weighted = 0;
+    for (size_t i = 0; i < smt.size(); ++i) {
+      const SMTThreadResult& r = smt[i];
+      double ipc = r.cycles ? static_cast<double>(r.instructions) / r.cycles : 0.0;
+      double base = alone[i].cycles ? static_cast<double>(alone[i].instructions) / alone[i].cycles : 0.0;
+      double relative = base > 0 ? ipc / base : 0.0;
+      insts += r.instructions;
+      serial += alone[i].cycles;
+      weighted += relative;
+      os << std::left << std::setw(8) << i << std::setw(8) << (r.halted ? std::to_string(r.exit_code) : "-")
+         << std::right << std::setw(12) << r.instructions << std::setw(12) << r.cycles << std::fixed
+         << std::setprecision(3) << std::setw(8) << ipc << std::setw(12) << base << std::setw(10) << relative
+         << "  " << r.label << "\n";
+      os.unsetf(std::ios::fixed);
+    }
+    os << std::fixed << std::setprecision(3) << "combined: " << insts << " instructions in " << cycles
+       << " cycles, ipc " << (cycles ? static_cast<double>(insts) / cycles : 0.0) << "\n"
+       << "weighted speedup " << weighted << ", " << serial << " cycles run one after another ("
+       << (cycles ? static_cast<double>(serial) / cycles : 0.0) << "x)\n";
+    os.unsetf(std::ios::fixed);
+  }
+};
@@ -0,0 +1,78 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <functional>
+#include <ostream>
+
+// 等宽分桶的直方图，用于统计各队列的占用
+class Histogram {
+ private:
+  uint32_t bucket_width = 1;
+  std::vector<uint64_t> buckets;
+
+ public:
+  Histogram() = default;
+  Histogram(uint32_t max_value, uint32_t num_buckets) {
+    bucket_width = (max_value + num_buckets) / num_buckets;
+    if (bucket_width == 0) bucket_width = 1;
+    buckets.resize(max_value / bucket_width + 1, 0);
+  }
+
+  void add(uint32_t value, uint64_t weight = 1) {
+    uint32_t b = value / bucket_width;
+    if (b >= buckets.size()) b = buckets.size() - 1;
+    buckets[b] += weight;
+  }
+
+  uint32_t get_bucket_width() const { return bucket_width; }
+  const std::vector<uint64_t>& get_buckets() const { return buckets; }
+};
+
+// 计数器注册表：各部件自己持有计数器并直接累加，这里只保存名字和指针，
+// 退出时统一导出，运行时没有额外开销
+class StatRegistry {
+ private:
+  std::vector<std::pair<std::string, const uint64_t*>> counters;
+  std::vector<std::pair<std::string, std::function<double()>>> formulas;
+  std::vector<std::pair<std::string, const Histogram*>> histograms;
+
+ public:
+  void add_counter(const std::string& name, const uint64_t* c) {
+    counters.push_back({name, c});
+  }
+
+  void add_formula(const std::string& name, std::function<double()> f) {
+    formulas.push_back({name, std::move(f)});
+  }
+
+  void add_histogram(const std::string& name, const Histogram* h) {
+    histograms.push_back({name, h});
+  }
+
+  const std::vector<std::pair<std::string, const uint64_t*>>& get_counters() const {
+    return counters;
+  }
+
+  void dump_json(std::ostream& os) const {
+    os << "{\n  \"counters\": {";
+    for (size_t i = 0; i < counters.size(); ++i) {
+      os << (i ? ",\n" : "\n") << "    \"" << counters[i].first << "\": " << *counters[i].second;
+    }
+    os << "\n  },\n  \"metrics\": {";
+    for (size_t i = 0; i < formulas.size(); ++i) {
+      os << (i ? ",\n" : "\n") << "    \"" << formulas[i].first << "\": " << formulas[i].second();
+    }
+    os << "\n  },\n  \"histograms\": {";
+    for (size_t i = 0; i < histograms.size(); ++i) {
+      const Histogram* h = histograms[i].second;
+      os << (i ? ",\n" : "\n") << "    \"" << histograms[i].first << "\": {\"bucket_width\": "
+         << h->get_bucket_width() << ", \"counts\": [";
+      const auto& b = h->get_buckets();
+      for (size_t j = 0; j < b.size(); ++j) {
+        os << (j ? ", " : "") << b[j];
+      }
+      os << "]}";
+    }
+    os << "\n  }\n}\n";
+  }
+};
@@ -0,0 +1,189 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <set>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <ostream>
+#include <stdexcept>
+
+// 设计空间扫描。描述文件每行为 "参数 取值1 取值2 ..."，参数名是配置选项去掉开头的 "--"，
+// 例如 "rob-size 32 64 128"、"predictor taken gshare"；"workload" 行列出要跑的程序，
+// 路径相对于描述文件。配置取全部组合，或者用拉丁超立方抽样取 samples 个。
+// 结果逐行追加到 CSV，再次运行时跳过 CSV 里已有的 (程序, 配置)
+
+struct SweepParam {
+  std::string name;
+  std::vector<std::string> values;
+};
+
+struct SweepConfig {
+  uint32_t samples = 0;   // 0 表示全部组合
+  uint32_t seed = 1;
+  std::string out = "sweep.csv";
+  uint64_t max_insts = UINT64_MAX;
+  bool skip_idle = true;
+  unsigned jobs = 1;
+};
+
+class Sweep {
+ private:
+  std::vector<SweepParam> params;
+  std::vector<std::string> workloads;
+  std::string dir;
+
+  // 每个参数取值的下标
+  std::vector<std::vector<uint32_t>> cartesian() const {
+    std::vector<std::vector<uint32_t>> points(1);
+    for (const auto& p : params) {
+      std::vector<std::vector<uint32_t>> next;
+      for (const auto& point : points) {
+        for (uint32_t v = 0; v < p.values.size(); ++v) {
+          next.push_back(point);
+          next.back().push_back(v);
+        }
+      }
+      points.swap(next);
+    }
+    return points;
+  }
+
+  // 每个参数把 n 个样本均匀分到各取值上再独立打乱，重复的组合只保留一个
+  std::vector<std::vector<uint32_t>> latin_hypercube(uint32_t n, uint32_t seed) const {
+    std::mt19937_64 rng(seed);
+    std::vector<std::vector<uint32_t>> points(n);
+    for (const auto& p : params) {
+      std::vector<uint32_t> strata(n);
+      std::iota(strata.begin(), strata.end(), 0);
+      std::shuffle(strata.begin(), strata.end(), rng);
+      for (uint32_t i = 0; i < n; ++i) {
+        points[i].push_back(static_cast<uint64_t>(strata[i]) * p.values.size() / n);
+      }
+    }
+    std::set<std::vector<uint32_t>> seen;
+    std::vector<std::vector<uint32_t>> unique;
+    for (auto& point : points) {
+      if (seen.insert(point).second) unique.push_back(point);
+    }
+    return unique;
+  }
+
+  std::string header() const {
+    std::string h = "workload";
+    for (const auto& p : params) h += "," + p.name;
+    return h + ",status,output,instructions,cycles,ipc,branch_mpki,l1d_miss_rate";
+  }
+
+  std::string key(const std::string& workload, const std::vector<uint32_t>& point) const {
+    std::string k = workload;
+    for (size_t i = 0; i < params.size(); ++i) k += "," + params[i].values[point[i]];
+    return k;
+  }
+
+  // CSV 里已经有结果的 (程序, 配置)
+  std::set<std::string> load_done(const std::string& path) const {
+    std::set<std::string> done;
+    std::ifstream in(path);
+    std::string line;
+    if (!std::getline(in, line)) return done;
+    if (line != header()) throw std::runtime_error(path + " was written by a sweep with different parameters");
+    while (std::getline(in, line)) {
+      // 前 1 + 参数个数列是键
+      size_t end = std::string::npos, pos = 0;
+      for (size_t i = 0; i <= params.size(); ++i) {
+        end = line.find(',', pos);
+        if (end == std::string::npos) break;
+        pos = end + 1;
+      }
+      if (end != std::string::npos) done.insert(line.substr(0, end));
+    }
+    return done;
+  }
+
+  static std::string row(const std::string& key, const BatchResult& r) {
+    std::ostringstream os;
+    auto counter = [&r](const char* name) {
+      auto it = r.counters.find(name);
+      return it == r.counters.end() ? 0 : it->second;
+    };
+    uint64_t insts = counter("instructions"), cycles = counter("cycles"), accesses = counter("l1d.accesses");
+    os << key << "," << r.status << ",";
+    if (r.status == "halted") os << r.exit_code;
+    os << "," << insts << "," << cycles << "," << (cycles ? static_cast<double>(insts) / cycles : 0.0) << ","
+       << (insts ? counter("branch_mispredicts") * 1000.0 / insts : 0.0) << ","
+       << (accesses ? static_cast<double>(counter("l1d.misses")) / accesses : 0.0);
+    return os.str();
+  }
+
+ public:
+  Sweep(const std::string& spec) {
+    std::ifstream in(spec);
+    if (!in) throw std::runtime_error("Cannot open sweep spec: " + spec);
+    size_t slash = spec.rfind('/');
+    if (slash != std::string::npos) dir = spec.substr(0, slash + 1);
+    std::string line;
+    while (std::getline(in, line)) {
+      std::istringstream ss(line);
+      std::string name, value;
+      if (!(ss >> name) || name[0] == '#') continue;
+      std::vector<std::string> values;
+      while (ss >> value) values.push_back(value);
+      if (values.empty()) throw std::runtime_error("No values for sweep parameter " + name);
+      if (name == "workload") {
+        workloads.insert(workloads.end(), values.begin(), values.end());
+      } else {
+        params.push_back({name, values});
+      }
+    }
+    if (workloads.empty()) throw std::runtime_error("Sweep spec lists no workload");
+  }
+
+  // l1/dram/core 是命令行给出的配置，扫描的参数在它上面修改；返回出错的任务数
+  size_t run(const SweepConfig& config, const Cache_Config& l1, const DRAM_Config& dram, const Core_Config& core,
+             ResultCache* cache, std::ostream& os) {
+    std::vector<std::vector<uint32_t>> points = cartesian();
+    if (config.samples != 0 && config.samples < points.size()) points = latin_hypercube(config.samples, config.seed);
+    std::set<std::string> done = load_done(config.out);
+
+    std::vector<BatchJob> jobs;
+    std::vector<std::string> keys;
+    for (const auto& workload : workloads) {
+      for (const auto& point : points) {
+        std::string k = key(workload, point);
+        if (done.count(k)) continue;
+        BatchJob job{workload[0] == '/' ? workload : dir + workload, k, l1, dram, core};
+        for (size_t i = 0; i < params.size(); ++i) {
+          std::string arg = "--" + params[i].name + "=" + params[i].values[point[i]];
+          if (!parse_config_option(arg.c_str(), job.l1, job.dram, job.core)) {
+            throw std::runtime_error("Unknown sweep parameter: " + params[i].name);
+          }
+        }
+        jobs.push_back(job);
+        keys.push_back(k);
+      }
+    }
+    os << workloads.size() << " workloads x " << points.size() << " configurations, " << jobs.size()
+       << " to run, " << workloads.size() * points.size() - jobs.size() << " already in " << config.out << std::endl;
+
+    bool fresh = std::ifstream(config.out).peek() == std::ifstream::traits_type::eof();
+    std::ofstream out(config.out, std::ios::app);
+    if (!out) throw std::runtime_error("Cannot open " + config.out);
+    if (fresh) out << header() << std::endl;
+    size_t failed = 0;
+    BatchRunner runner(jobs, true, config.skip_idle, config.max_insts);
+    runner.set_cache(cache);
+    runner.set_callback([&](size_t i, const BatchResult& r) {
+      if (r.status == "error") {
+        os << jobs[i].label << ": " << r.error << std::endl;
+        failed++;
+        return;
+      }
+      out << row(keys[i], r) << std::endl;
+    });
+    runner.run(config.jobs);
+    return failed;
+  }
+};
@@ -0,0 +1,332 @@
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <zlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// 已提交指令的二进制 trace。
+// 文件格式：8 字节 magic + 4 字节版本 + 4 字节保留，之后是若干块，
+// 每块为 {记录数, 原始字节数, 压缩后字节数} 三个 uint32 加上 zlib 压缩的数据。
+// 块内每条记录依次为：pc 相对 (上一条 pc + 4) 的差值（zigzag varint）、
+// 指令原码（4 字节）、写 rd 时 rd 新值相对该寄存器上次值的差值（zigzag varint）、
+// 访存指令的地址相对上次访存地址的差值（zigzag varint）和访存的值（varint）。
+// 每块独立编码，解码时不依赖前面的块。
+
+const char TRACE_MAGIC[8] = {'R', 'V', 'T', 'R', 'A', 'C', 'E', '\0'};
+const uint32_t TRACE_VERSION = 1;
+const uint32_t TRACE_BLOCK_RECORDS = 1 << 16;
+
+struct TraceRecord {
+  uint32_t pc;
+  uint32_t inst;
+  uint32_t rd_value;    // 不写 rd 的指令为 0
+  uint32_t mem_addr;    // 非访存指令为 0
+  uint32_t mem_value;   // store 写入的值 / load 写入 rd 的值
+};
+
+inline bool trace_writes_rd(uint32_t inst) {
+  uint32_t opcode = inst & 0x7F;
+  bool has_rd = opcode == 0b0110011 || opcode == 0b0010011 || opcode == 0b0000011 ||
+                opcode == 0b0110111 || opcode == 0b0010111 || opcode == 0b1101111 ||
+                opcode == 0b1100111 || opcode == 0b0101111 || (opcode == 0b1110011 && (inst >> 12) & 0x7);
+  return has_rd && ((inst >> 7) & 0x1F) != 0;
+}
+
+inline bool trace_is_memory(uint32_t inst) {
+  uint32_t opcode = inst & 0x7F;
+  return opcode == 0b0000011 || opcode == 0b0100011;
+}
+
+// 条件分支；是否跳转要看下一条记录的 PC 是不是 pc + 4
+inline bool trace_is_branch(uint32_t inst) {
+  return (inst & 0x7F) == 0b1100011;
+}
+
+inline void put_varint(std::vector<uint8_t>& out, uint32_t v) {
+  while (v >= 0x80) {
+    out.push_back(static_cast<uint8_t>(v | 0x80));
+    v >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(v));
+}
+
+inline uint32_t get_varint(const uint8_t*& p, const uint8_t* end) {
+  uint32_t v = 0;
+  for (int shift = 0; p < end && shift < 35; shift += 7) {
+    uint8_t b = *p++;
+    v |= static_cast<uint32_t>(b & 0x7F) << shift;
+    if (!(b & 0x80)) return v;
+  }
+  throw std::runtime_error("Corrupt trace block");
+}
+
+inline uint32_t zigzag(int32_t v) {
+  return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31);
+}
+
+inline int32_t unzigzag(uint32_t v) {
+  return static_cast<int32_t>(v >> 1) ^ -static_cast<int32_t>(v & 1);
+}
+
+// 块内编码时的上下文
+struct TraceDeltaState {
+  uint32_t pc = 0;
+  uint32_t mem_addr = 0;
+  uint32_t regs[32] = {};
+
+  void reset() {
+    *this = TraceDeltaState();
+    pc = static_cast<uint32_t>(-4);
+  }
+};
+
+inline void encode_record(std::vector<uint8_t>& out, TraceDeltaState& st, const TraceRecord& r) {
+  put_varint(out, zigzag(static_cast<int32_t>(r.pc - (st.pc + 4))));
+  st.pc = r.pc;
+  for (int i = 0; i < 4; ++i) out.push_back(static_cast<uint8_t>(r.inst >> (8 * i)));
+  if (trace_writes_rd(r.inst)) {
+    uint32_t rd = (r.inst >> 7) & 0x1F;
+    put_varint(out, zigzag(static_cast<int32_t>(r.rd_value - st.regs[rd])));
+    st.regs[rd] = r.rd_value;
+  }
+  if (trace_is_memory(r.inst)) {
+    put_varint(out, zigzag(static_cast<int32_t>(r.mem_addr - st.mem_addr)));
+    st.mem_addr = r.mem_addr;
+    put_varint(out, r.mem_value);
+  }
+}
+
+inline TraceRecord decode_record(const uint8_t*& p, const uint8_t* end, TraceDeltaState& st) {
+  TraceRecord r{};
+  r.pc = st.pc + 4 + static_cast<uint32_t>(unzigzag(get_varint(p, end)));
+  st.pc = r.pc;
+  if (end - p < 4) throw std::runtime_error("Corrupt trace block");
+  r.inst = static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+  p += 4;
+  if (trace_writes_rd(r.inst)) {
+    uint32_t rd = (r.inst >> 7) & 0x1F;
+    r.rd_value = st.regs[rd] + static_cast<uint32_t>(unzigzag(get_varint(p, end)));
+    st.regs[rd] = r.rd_value;
+  }
+  if (trace_is_memory(r.inst)) {
+    r.mem_addr = st.mem_addr + static_cast<uint32_t>(unzigzag(get_varint(p, end)));
+    st.mem_addr = r.mem_addr;
+    r.mem_value = get_varint(p, end);
+  }
+  return r;
+}
+
+// 接收已提交指令的记录，CPU 的两种执行模型都会调用
+class TraceSink {
+ public:
+  virtual ~TraceSink() = default;
+  virtual void record(const TraceRecord& r) = 0;
+};
+
+// 模拟线程把记录放入无锁环形缓冲区，后台线程负责编码、压缩和写文件
+class TraceWriter : public TraceSink {
+ private:
+  SpscRing<TraceRecord> ring{16};
+  std::atomic<bool> stopping{false};
+  std::thread writer;
+  FILE* out;
+  std::vector<TraceRecord> block;
+  std::vector<uint8_t> raw;
+  std::vector<uint8_t> packed;
+  uint64_t records = 0;
+  uint64_t bytes = 0;
+  std::string error;   // 写线程上的错误，join 之后由 stop() 抛出
+
+  void write(const void* data, size_t size) {
+    if (std::fwrite(data, 1, size, out) != size) throw std::runtime_error("Trace write failed");
+    bytes += size;
+  }
+
+  void flush_block() {
+    if (block.empty()) return;
+    raw.clear();
+    TraceDeltaState st;
+    st.reset();
+    for (const auto& r : block) encode_record(raw, st, r);
+    uLongf packed_size = compressBound(raw.size());
+    packed.resize(packed_size);
+    if (compress2(packed.data(), &packed_size, raw.data(), raw.size(), Z_BEST_SPEED) != Z_OK) {
+      throw std::runtime_error("Trace compression failed");
+    }
+    uint32_t header[3] = {static_cast<uint32_t>(block.size()), static_cast<uint32_t>(raw.size()),
+                          static_cast<uint32_t>(packed_size)};
+    block.clear();
+    write(header, sizeof(header));
+    write(packed.data(), packed_size);
+  }
+
+  void writer_loop() {
+    // 出错后仍然要继续取走记录，否则模拟线程会在满的环形缓冲上一直等
+    auto fail = [this](const std::exception& e) {
+      if (error.empty()) error = e.what();
+      block.clear();
+    };
+    while (true) {
+      bool stop = stopping.load(std::memory_order_acquire);
+      uint64_t n = ring.drain([&](const TraceRecord& r) {
+        if (!error.empty()) return;
+        block.push_back(r);
+        if (block.size() < TRACE_BLOCK_RECORDS) return;
+        try {
+          flush_block();
+        } catch (const std::exception& e) {
+          fail(e);
+        }
+      });
+      if (stop && n == 0) break;
+      if (n == 0) std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    if (!error.empty()) return;
+    try {
+      flush_block();
+      if (std::fflush(out) != 0) throw std::runtime_error("Trace write failed");
+    } catch (const std::exception& e) {
+      fail(e);
+    }
+  }
+
+  void finish() {
+    if (!writer.joinable()) return;
+    stopping.store(true, std::memory_order_release);
+    writer.join();
+    if (std::fclose(out) != 0 && error.empty()) error = "Trace write failed";
+  }
+
+ public:
+  TraceWriter(const std::string& path) {
+    out = std::fopen(path.c_str(), "wb");
+    if (out == nullptr) throw std::runtime_error("Cannot open trace file: " + path);
+    uint32_t header[2] = {TRACE_VERSION, 0};
+    if (std::fwrite(TRACE_MAGIC, sizeof(TRACE_MAGIC), 1, out) != 1 || std::fwrite(header, sizeof(header), 1, out) != 1) {
+      std::fclose(out);
+      throw std::runtime_error("Cannot write trace file: " + path);
+    }
+    bytes = sizeof(TRACE_MAGIC) + sizeof(header);
+    block.reserve(TRACE_BLOCK_RECORDS);
+    writer = std::thread(&TraceWriter::writer_loop, this);
+  }
+
+  // 析构时不抛异常，写入错误只能从 stop() 得到
+  ~TraceWriter() {
+    finish();
+  }
+
+  TraceWriter(const TraceWriter&) = delete;
+  TraceWriter& operator=(const TraceWriter&) = delete;
+
+  // 只在模拟线程调用
+  void record(const TraceRecord& r) override {
+    ring.push(r);
+    records++;
+  }
+
+  // 等写线程写完并关闭文件，写入失败时抛出
+  void stop() {
+    finish();
+    if (!error.empty()) {
+      std::string message = error;
+      error.clear();
+      throw std::runtime_error(message);
+    }
+  }
+
+  uint64_t get_records() const { return records; }
+  uint64_t get_bytes() const { return bytes; }
+};
+
+// 用 mmap 顺序读取 trace，每次解压一个块
+// 按提交顺序逐条给出记录，回放时乱序模型从这里取指令
+class TraceSource {
+ public:
+  virtual ~TraceSource() = default;
+  virtual bool next(TraceRecord& r) = 0;
+};
+
+class TraceReader : public TraceSource {
+ private:
+  int fd = -1;
+  const uint8_t* base = nullptr;
+  size_t size = 0;
+  size_t offset = 0;
+  std::vector<uint8_t> raw;
+  std::vector<TraceRecord> block;
+  size_t index = 0;
+
+  bool load_block() {
+    if (offset + 12 > size) return false;
+    uint32_t header[3];
+    std::memcpy(header, base + offset, sizeof(header));
+    offset += sizeof(header);
+    if (offset + header[2] > size) throw std::runtime_error("Truncated trace file");
+    raw.resize(header[1]);
+    uLongf raw_size = header[1];
+    if (uncompress(raw.data(), &raw_size, base + offset, header[2]) != Z_OK || raw_size != header[1]) {
+      throw std::runtime_error("Corrupt trace block");
+    }
+    offset += header[2];
+    block.clear();
+    TraceDeltaState st;
+    st.reset();
+    const uint8_t* p = raw.data();
+    const uint8_t* end = p + raw.size();
+    for (uint32_t i = 0; i < header[0]; ++i) {
+      block.push_back(decode_record(p, end, st));
+    }
+    index = 0;
+    return true;
+  }
+
+ public:
+  TraceReader(const std::string& path) {
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Cannot open trace file: " + path);
+    struct stat st;
+    ::fstat(fd, &st);
+    size = st.st_size;
+    void* p = size >= 16 ? ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    uint32_t version = 0;
+    if (p != MAP_FAILED) {
+      base = static_cast<const uint8_t*>(p);
+      ::madvise(p, size, MADV_SEQUENTIAL);
+      std::memcpy(&version, base + 8, sizeof(version));
+    }
+    if (p == MAP_FAILED || std::memcmp(base, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 ||
+        version != TRACE_VERSION) {
+      if (p != MAP_FAILED) ::munmap(p, size);
+      ::close(fd);
+      throw std::runtime_error("Not a trace file: " + path);
+    }
+    offset = 16;
+  }
+
+  ~TraceReader() {
+    if (base != nullptr) ::munmap(const_cast<uint8_t*>(base), size);
+    if (fd >= 0) ::close(fd);
+  }
+
+  TraceReader(const TraceReader&) = delete;
+  TraceReader& operator=(const TraceReader&) = delete;
+
+  bool next(TraceRecord& r) override {
+    while (index == block.size()) {
+      if (!load_block()) return false;
+    }
+    r = block[index++];
+    return true;
+  }
+};
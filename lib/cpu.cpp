@@ -0,0 +1,591 @@
+#include "../include/cpu.cpp"
+
+// CPU 较大的成员函数（功能执行和乱序流水线的各级）只在这里编译一次，
+// 主程序、ilp 和 libcpusim 都链接同一份目标文件
+
+// 结果缓存的键包含它，模拟器核心重新编译后旧结果不再命中
+extern const char SIM_BUILD_ID[] = __DATE__ " " __TIME__ " " __VERSION__;
+
+void CPU::register_stats() {
+  rob_occupancy = Histogram(rob.get_capacity(), 32);
+  rs_occupancy = Histogram(RS.get_capacity(), 32);
+  lsb_occupancy = Histogram(LSB.get_capacity(), 32);
+  stats.add_counter("cycles", &cycle);
+  stats.add_counter("instructions", &instret);
+  stats.add_counter("branch_mispredicts", &mispredicts);
+  stats.add_counter("issued", &issued);
+  stats.add_counter("topdown.frontend_bound", &slots_frontend);
+  stats.add_counter("topdown.backend_bound.memory", &slots_backend_memory);
+  stats.add_counter("topdown.backend_bound.core", &slots_backend_core);
+  stats.add_counter("topdown.wrong_path_stall", &slots_wrong_path);
+  ms.register_stats(stats);
+  auto fraction = [this](uint64_t v) { return cycle ? static_cast<double>(v) / (cycle * width) : 0.0; };
+  stats.add_formula("ipc", [this] { return cycle ? static_cast<double>(instret) / cycle : 0.0; });
+  stats.add_formula("topdown.retiring", [this, fraction] { return fraction(instret); });
+  stats.add_formula("topdown.bad_speculation", [this, fraction] { return fraction(issued - instret + slots_wrong_path); });
+  stats.add_formula("topdown.frontend_bound", [this, fraction] { return fraction(slots_frontend); });
+  stats.add_formula("topdown.backend_bound.memory", [this, fraction] { return fraction(slots_backend_memory); });
+  stats.add_formula("topdown.backend_bound.core", [this, fraction] { return fraction(slots_backend_core); });
+  stats.add_histogram("rob_occupancy", &rob_occupancy);
+  stats.add_histogram("rs_occupancy", &rs_occupancy);
+  stats.add_histogram("lsb_occupancy", &lsb_occupancy);
+}
+
+CPU::CPU() {
+  ms.set_events(&events);
+  register_stats();
+}
+
+CPU::CPU(const Cache_Config& l1, const DRAM_Config& dram, const Core_Config& core)
+    : rob(core.rob_size), RS(core.rs_size), LSB(core.lsb_size), predictor(core.predictor), ms(l1, dram),
+      width(core.width) {
+  ms.set_events(&events);
+  register_stats();
+}
+
+uint32_t CPU::amo(const std::string& op, uint32_t rd, uint32_t rs1, uint32_t rs2) {
+  uint32_t addr = regs.read_unsigned(rs1);
+  uint32_t src = regs.read_unsigned(rs2);
+  uint32_t old = 0;
+  if (op == "lr.w") {
+    old = mem.load_word_atomic(addr);
+    reservation_valid = true;
+    reservation_addr = addr;
+    reservation_value = old;
+  } else if (op == "sc.w") {
+    bool ok = reservation_valid && reservation_addr == addr &&
+              mem.compare_exchange_word(addr, reservation_value, src);
+    reservation_valid = false;
+    old = ok ? 0 : 1;
+  } else {
+    old = mem.atomic_update(addr, [&op, src](uint32_t v) -> uint32_t {
+      if (op == "amoswap.w") return src;
+      if (op == "amoadd.w") return v + src;
+      if (op == "amoxor.w") return v ^ src;
+      if (op == "amoand.w") return v & src;
+      if (op == "amoor.w") return v | src;
+      if (op == "amomin.w") return static_cast<int32_t>(v) < static_cast<int32_t>(src) ? v : src;
+      if (op == "amomax.w") return static_cast<int32_t>(v) > static_cast<int32_t>(src) ? v : src;
+      if (op == "amominu.w") return v < src ? v : src;
+      return v > src ? v : src;
+    });
+  }
+  regs.set(rd, old);
+  mem.step_PC();
+  return old;
+}
+
+void CPU::execute(uint32_t instruction) {
+  if (instruction == HALT_INSTRUCTION || mem.get_PC() == 8) {
+    halt();
+    return;
+  }
+  if (profiler != nullptr) profiler->on_execute(mem.get_PC(), instruction);
+  Instruction ins(instruction);
+  std::string operation = ins.get_op();
+  TraceRecord trace_record{mem.get_PC(), instruction, 0, 0, 0};
+  if (tracer != nullptr && ::is_memory(operation)) {
+    int32_t offset = ins.get_type() == 'S' ? ins.get_s_imm() : ins.get_i_imm();
+    trace_record.mem_addr = regs.read_unsigned(ins.get_rs1()) + offset;
+    trace_record.mem_value = regs.read_unsigned(ins.get_rs2());
+    if (operation == "sb") trace_record.mem_value &= 0xFF;
+    if (operation == "sh") trace_record.mem_value &= 0xFFFF;
+  } else if (tracer != nullptr && ins.get_type() == 'A') {
+    trace_record.mem_addr = regs.read_unsigned(ins.get_rs1());
+  }
+  //if (instruction != 0) std::cout << "instruction: " << std::bitset<32>(instruction) << std::endl;
+  //std::cout << "pos: " << std::hex << (mem.get_PC()) << std::endl;    
+  //if (instruction != 0) std::cout << "op: " << operation<< std::endl;
+  if (operation == "lb") {
+    uint32_t rd = ins.get_rd();
+    uint32_t rs1 = ins.get_rs1();
+    int32_t imm = ins.get_i_imm();
+    lb(rd, rs1, imm);
+  } else if (operation == "lh") {
+    uint32_t rd = ins.get_rd();
+    uint32_t rs1 = ins.get_rs1();
+    int32_t imm = ins.get_i_imm();
+    lh(rd, rs1, imm);
+  } else if (operation == "lw") {
+    uint32_t rd = ins.get_rd();
+    uint32_t rs1 = ins.get_rs1();
+    int32_t imm = ins.get_imm();
+    lw(rd, rs1, imm);
+  } else if (operation == "lbu") {
+    uint32_t rd = ins.get_rd();
+    uint32_t rs1 = ins.get_rs1();
+    int32_t imm = ins.get_imm();
+    lbu(rd, rs1, imm);
+  } else if (operation == "lhu") {
+    uint32_t rd = ins.get_rd();
+    uint32_t rs1 = ins.get_rs1();
+    int32_t imm = ins.get_imm();
+    lhu(rd, rs1, imm);
+  } else if (operation == "lui") {
+    uint32_t rd = ins.get_rd();
+    int32_t imm = ins.get_imm();
+    lui(rd, imm);
+  } else if (operation == "auipc") {
+    uint32_t rd = ins.get_rd();
+    int32_t imm = ins.get_imm();
+    auipc(rd, imm);
+  } else if (operation == "jal") {
+    uint32_t rd = ins.get_rd();
+    uint32_t offset = ins.get_jal_imm();
+    jal(rd, static_cast<int32_t>(offset));
+  } else if (operation == "jalr") {
+    uint32_t rd = ins.get_rd();
+    uint32_t rs1 = ins.get_rs1();
+    int32_t imm = ins.get_imm();
+    jalr(rd, rs1, imm);
+  } else if (operation == "beq") {
+    uint32_t rs1 = ins.get_rs1();
+    uint32_t rs2 = ins.get_rs2();
+    int32_t imm = ins.get_imm();
+    beq(rs1, rs2, imm);
+  } else if (operation == "bne") {
+    uint32_t rs1 = ins.get_rs1();
+    uint32_t rs2 = ins.get_rs2();
+    int32_t imm = ins.get_imm();
+    bne(rs1, rs2, imm);
+  } else if (operation == "blt") {
+    uint32_t rs1 = ins.get_rs1();
+    uint32_t rs2 = ins.get_rs2();
+    int32_t imm = ins.get_imm();
+    blt(rs1, rs2, imm);
+  } else if (operation == "bge") {
+    uint32_t rs1 = ins.get_rs1();
+    uint32_t rs2 = ins.get_rs2();
+    int32_t imm = ins.get_imm();
+    bge(rs1, rs2, imm);
+  } else if (operation == "bltu") {
+    uint32_t rs1 = ins.get_rs1();
+    uint32_t rs2 = ins.get_rs2();
+    int32_t imm = ins.get_imm();
+    bltu(rs1, rs2, imm);
+  } else if (operation == "bgeu") {
+    uint32_t rs1 = ins.get_rs1();
+    uint32_t rs2 = ins.get_rs2();
+    int32_t imm = ins.get_imm();
+    bgeu(rs1, rs2, imm);
+  } else if (operation == "sb") {
+    uint32_t rs1 = ins.get_rs1();
+    uint32_t rs2 = ins.get_rs2();
+    int32_t imm = ins.get_imm();
+    sb(rs1, rs2, imm);
+  } else if (operation == "sh") {
+    uint32_t rs1 = ins.get_rs1();
+    uint32_t rs2 = ins.get_rs2();
+    int32_t imm = ins.get_imm();
+    sh(rs1, rs2, imm);
+  } else if (operation == "sw") {
+    uint32_t rs1 = ins.get_rs1();
+    uint32_t rs2 = ins.get_rs2();
+    int32_t imm = ins.get_imm();
+    sw(rs1, rs2, imm);
+  } else if (operation == "addi") {
+    uint32_t rd = ins.get_rd();
+    uint32_t rs1 = ins.get_rs1();
+    int32_t imm = ins.get_imm();
+    addi(rd, rs1, imm);
+  } else if (operation == "slti") {
+    uint32_t rd = ins.get_rd();
+    uint32_t rs1 = ins.get_rs1();
+    int32_t imm = ins.get_imm();
+    slti(rd, rs1, imm);
+  } else if (operation == "sltiu") {
+    uint32_t rd = ins.get_rd();
+    uint32_t rs1 = ins.get_rs1();
+    int32_t imm = ins.get_imm();
+    sltiu(rd, rs1, imm);
+  } else if (operation == "xori") {
+    uint32_t rd = ins.get_rd();
+    uint32_t rs1 = ins.get_rs1();
+    int32_t imm = ins.get_imm();
+    xori(rd, rs1, imm);
+  } else if (operation == "ori") {
+    uint32_t rd = ins.get_rd();
+    uint32_t rs1 = ins.get_rs1();
+    int32_t imm = ins.get_imm();
+    ori(rd, rs1, imm);
+  } else if (operation == "andi") {
+    uint32_t rd = ins.get_rd();
+    uint32_t rs1 = ins.get_rs1();
+    int32_t imm = ins.get_imm();
+    andi(rd, rs1, imm);
+  } else if (operation == "slli") {
+    uint32_t rd = ins.get_rd();
+    uint32_t rs1 = ins.get_rs1();
+    uint32_t imm = ins.get_shamt();
+    slli(rd, rs1, imm);
+  } else if (operation == "srli") {
+    uint32_t rd = ins.get_rd();
+    uint32_t rs1 = ins.get_rs1();
+    uint32_t imm = ins.get_shamt();
+    srli(rd, rs1, imm);
+  } else if (operation == "srai") {
+    uint32_t rd = ins.get_rd();
+    uint32_t rs1 = ins.get_rs1();
+    uint32_t imm = ins.get_shamt();
+    srai(rd, rs1, imm);
+  } else if (operation == "add") {
+    uint32_t rd = ins.get_rd();
+    uint32_t rs1 = ins.get_rs1();
+    uint32_t rs2 = ins.get_rs2();
+    add_op(rd, rs1, rs2);
+  } else if (operation == "sub") {
+    uint32_t rd = ins.get_rd();
+    uint32_t rs1 = ins.get_rs1();
+    uint32_t rs2 = ins.get_rs2();
+    sub_op(rd, rs1, rs2);
+  } else if (operation == "sll") {
+    uint32_t rd = ins.get_rd();
+    uint32_t rs1 = ins.get_rs1();
+    uint32_t rs2 = ins.get_rs2();
+    sll_op(rd, rs1, rs2);
+  } else if (operation == "slt") {
+    uint32_t rd = ins.get_rd();
+    uint32_t rs1 = ins.get_rs1();
+    uint32_t rs2 = ins.get_rs2();
+    slt_op(rd, rs1, rs2);
+  } else if (operation == "sltu") {
+    uint32_t rd = ins.get_rd();
+    uint32_t rs1 = ins.get_rs1();
+    uint32_t rs2 = ins.get_rs2();
+    sltu_op(rd, rs1, rs2);
+  } else if (operation == "xor") {
+    uint32_t rd = ins.get_rd();
+    uint32_t rs1 = ins.get_rs1();
+    uint32_t rs2 = ins.get_rs2();
+    cpu_xor(rd, rs1, rs2);
+  } else if (operation == "srl") {
+    uint32_t rd = ins.get_rd();
+    uint32_t rs1 = ins.get_rs1();
+    uint32_t rs2 = ins.get_rs2();
+    cpu_srl(rd, rs1, rs2);
+  } else if (operation == "sra") {
+    uint32_t rd = ins.get_rd();
+    uint32_t rs1 = ins.get_rs1();
+    uint32_t rs2 = ins.get_rs2();
+    cpu_sra(rd, rs1, rs2);
+  } else if (operation == "or") {
+    uint32_t rd = ins.get_rd();
+    uint32_t rs1 = ins.get_rs1();
+    uint32_t rs2 = ins.get_rs2();
+    cpu_or(rd, rs1, rs2);
+  } else if (operation == "and") {
+    uint32_t rd = ins.get_rd();
+    uint32_t rs1 = ins.get_rs1();
+    uint32_t rs2 = ins.get_rs2();
+    cpu_and(rd, rs1, rs2);
+  } else if (ins.get_type() == 'A' && operation != "no instruction") {
+    uint32_t result = amo(operation, ins.get_rd(), ins.get_rs1(), ins.get_rs2());
+    // 目的寄存器是 x0 时 trace 也能看出 sc.w 是否成功
+    if (operation == "sc.w") trace_record.rd_value = result;
+  } else if (operation == "fence") {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    mem.step_PC();
+  } else if (ins.get_type() == 'C' && operation != "no instruction") {
+    csr(ins.get_rd(), ins.get_csr());
+  } else {
+    //std::cout << "invalid instruction" << std::endl;
+  }
+  if (callstack != nullptr) callstack->on_retire(instruction, mem.get_PC());
+  if (tracer != nullptr) {
+    if (trace_writes_rd(instruction)) trace_record.rd_value = regs.read_unsigned(ins.get_rd());
+    if (ins.get_type() == 'I' && ::is_memory(operation)) trace_record.mem_value = trace_record.rd_value;
+    tracer->record(trace_record);
+  }
+}
+
+void CPU::stall(uint64_t n) {
+  if (n == 0) return;
+  stalled_slots = width;
+  last_slot = Slot::BACKEND_MEMORY;
+  account(n);
+  cycle += n;
+}
+
+void CPU::read_operand(uint32_t r, uint32_t& V, uint32_t& Q) {
+  V = 0;
+  Q = 0;
+  if (!regs.is_pending(r)) {
+    V = regs.read_unsigned(r);
+    return;
+  }
+  int id = regs.get_reorder(r);
+  ROB_Entry& e = rob.get_entry(id);
+  if (e.state == ROB_State::WRITE_RESULT) {
+    V = e.value;
+  } else {
+    Q = id + 1;
+  }
+}
+
+void CPU::flush_pipeline(uint32_t correct_pc) {
+  PIPE_LOG(for (uint32_t i = 0; i < rob.get_size(); ++i) kanata->squash(cycle, pipe_ids[rob.at(i).ID]));
+  rob.flush();
+  RS.flush();
+  LSB.flush();
+  regs.reset();
+  mem.set_PC(correct_pc);
+}
+
+void CPU::halt() {
+  if (output != nullptr) *output << std::dec << get_exit_code() << std::endl;
+  halted = true;
+}
+
+bool CPU::commit_stage() {
+  if (rob.is_empty()) {
+    if (replay == nullptr || replay_valid) return false;
+    halt();
+    return true;
+  }
+  ROB_Entry& head = rob.front();
+  // 从镜像取来的指令到了 ROB 头部说明 trace 已经结束，后面不是停机指令时同样停下
+  if (head.instruction == HALT_INSTRUCTION || head.pc == 8 || head.from_image) {
+    halt();
+    return true;
+  }
+  if (head.unsupported) throw std::runtime_error("RV32A is only supported by the functional model");
+  if (head.state != ROB_State::WRITE_RESULT) return false;
+
+  TraceRecord trace_record{head.pc, head.instruction, 0, head.mem_addr, 0};
+  LSB_Entry* store = LSB.find(head.ID);
+  if (store != nullptr) {
+    if (!ms.store(store->addr, cycle)) return false;
+    trace_record.mem_addr = store->addr;
+    trace_record.mem_value = store->value;
+    if (store->op == SB) trace_record.mem_value &= 0xFF;
+    if (store->op == SH) trace_record.mem_value &= 0xFFFF;
+    if (replay == nullptr) LSB.write_store(*store, mem);
+    LSB.remove(head.ID);
+  }
+
+  uint32_t correct_pc;
+  bool mispredict = rob.check_mispredict(correct_pc);
+  if ((head.instruction & 0x7F) == 0b1100011) predictor.update(head.pc, head.is_taken);
+  if (profiler != nullptr) profiler->on_execute(head.pc, head.instruction);
+  if (callstack != nullptr) callstack->on_retire(head.instruction, head.next_pc);
+  if (tracer != nullptr) {
+    if (head.destination != 0) trace_record.rd_value = head.value;
+    if (trace_is_memory(head.instruction) && store == nullptr) trace_record.mem_value = trace_record.rd_value;
+    tracer->record(trace_record);
+  }
+  auto [rob_id, value, dest] = rob.commit();
+  PIPE_LOG(kanata->retire(cycle, pipe_ids[rob_id], static_cast<uint32_t>(instret)));
+  if (dest != 0) {
+    regs.set(dest, value);
+    if (regs.get_reorder(dest) == static_cast<int>(rob_id)) regs.clear_reorder(dest);
+  }
+  instret++;
+
+  if (mispredict) {
+    mispredicts++;
+    flush_pipeline(correct_pc);
+    replay_wrong_path = false;
+  }
+  return true;
+}
+
+bool CPU::memory_stage() {
+  mem_done.clear();
+  bool progress = ms.tick(cycle, mem_done);
+  for (uint64_t seq : mem_done) {
+    uint32_t rob_id, value;
+    if (LSB.complete(seq, replay != nullptr ? nullptr : &mem, rob, rob_id, value)) {
+      PIPE_LOG(pipe_stage(rob_id, PipeStage::WRITEBACK));
+      broadcast(rob_id, value);
+    }
+  }
+  int sent = -1;
+  if (LSB.run(ms, rob, cycle, &sent)) progress = true;
+  PIPE_LOG(if (sent >= 0) pipe_stage(sent, PipeStage::MEMORY));
+  return progress;
+}
+
+bool CPU::execute_stage() {
+  exec_done.clear();
+  uint32_t n = 0;
+  for (; n < width; ++n) {
+    auto ready = RS.get_ready_entry();
+    if (!ready.has_value()) break;
+    RS_Entry& e = ready.value();
+    Instruction inst(e.instruction);
+    ALU_Result res;
+    if (replay != nullptr && !rob.get_entry(e.ROB_ID).from_image) {
+      ROB_Entry& entry = rob.get_entry(e.ROB_ID);
+      res = {entry.value, entry.next_pc};
+    } else {
+      res = alu.execute(inst, e.pc, e.Vj, e.Vk, e.A);
+    }
+    rob.write_result(e.ROB_ID, res.value, res.next_pc);
+    RS.remove(e.ROB_ID);
+    exec_done.push_back({e.ROB_ID, res.value});
+    PIPE_LOG(pipe_stage(e.ROB_ID, PipeStage::EXECUTE), pipe_writeback.push_back(e.ROB_ID));
+  }
+  for (auto [rob_id, value] : exec_done) broadcast(rob_id, value);
+  return n > 0;
+}
+
+bool CPU::issue_stage() {
+  issue_blocked_by_lsb = false;
+  fetch_starved = false;
+  if (replay != nullptr && !replay_fetch_wrong_path && (!replay_valid || replay_wrong_path)) {
+    fetch_starved = !replay_wrong_path;
+    return false;
+  }
+  bool oracle = replay != nullptr && replay_valid && !replay_wrong_path;
+  uint32_t pc = oracle ? replay_cur.pc : mem.get_PC();
+  Instruction inst(oracle ? replay_cur.inst : mem.read_word(pc));
+  std::string op = inst.get_op();
+  bool atomic = inst.get_type() == 'A' && op != "no instruction";
+  bool memory_op = !atomic && is_memory(inst);
+  if (rob.is_full()) return false;
+  if (memory_op ? LSB.is_full() : RS.is_full()) {
+    issue_blocked_by_lsb = memory_op;
+    return false;
+  }
+
+  uint32_t next_pc = pc + 4;
+  bool branch = is_branch(op);
+  if (op == "jal") {
+    next_pc = pc + inst.get_jal_imm();
+  } else if (branch && op != "jalr" && predictor.predict(pc)) {
+    next_pc = pc + inst.get_b_imm();
+  }
+
+  uint32_t rs1 = inst.get_rs1(), rs2 = inst.get_rs2();
+  uint32_t Vj = 0, Vk = 0, Qj = 0, Qk = 0;
+  if (has_rs1(op)) read_operand(rs1, Vj, Qj);
+  if (has_rs2(op)) read_operand(rs2, Vk, Qk);
+
+  bool valid = op != "no instruction";
+  uint32_t dest = (valid && !atomic && has_dest(op)) ? inst.get_rd() : 0;
+  int rob_id = rob.allocate(inst.code, dest, branch, false, next_pc != pc + 4, next_pc, pc);
+  if (dest != 0) regs.set_reorder(dest, rob_id);
+  // 本模型取指、重命名和分派在同一个周期完成
+  PIPE_LOG(pipe_ids[rob_id] = pipe_next_id++, kanata->fetch(cycle, pipe_ids[rob_id], pc, inst.code),
+           pipe_stage(rob_id, PipeStage::FETCH), pipe_stage(rob_id, PipeStage::ISSUE),
+           pipe_stage(rob_id, PipeStage::DISPATCH));
+  if (oracle) {
+    ROB_Entry& entry = rob.get_entry(rob_id);
+    entry.value = replay_cur.rd_value;
+    replay_valid = replay->next(replay_cur);
+    if (replay_valid) entry.next_pc = replay_cur.pc;
+    // trace 结束时不知道实际的下一条 PC，从镜像取指的话先按预测走
+    if (!replay_valid && replay_fetch_wrong_path) entry.next_pc = next_pc;
+    replay_wrong_path = entry.next_pc != next_pc;
+  } else if (replay != nullptr) {
+    rob.get_entry(rob_id).from_image = true;
+  }
+
+  if (!valid) {
+    // 无法识别的指令当作空操作
+    rob.write_result(rob_id, 0);
+  } else if (atomic) {
+    rob.get_entry(rob_id).unsupported = true;
+    rob.write_result(rob_id, 0);
+  } else if (memory_op) {
+    LSB_Entry entry(LoadStoreBuffer::to_lsb_op(op), rob_id, Vj, Qj, inst.get_imm(), inst.code, Vk, Qk);
+    LSB.insert(entry);
+  } else {
+    RS.insert(RS_Entry(inst.code, true, Vj, Vk, Qj, Qk, rob_id, inst.get_imm(), pc));
+  }
+  mem.set_PC(next_pc);
+  issued++;
+  return true;
+}
+
+Slot CPU::classify_stall() {
+  if (replay_wrong_path && !replay_fetch_wrong_path) return Slot::WRONG_PATH;
+  if (fetch_starved) return Slot::FRONTEND;
+  if (issue_blocked_by_lsb) return Slot::BACKEND_MEMORY;
+  if (!rob.is_empty()) {
+    ROB_Entry& head = rob.front();
+    Instruction inst(head.instruction);
+    if (is_memory(inst)) return Slot::BACKEND_MEMORY;
+  }
+  return Slot::BACKEND_CORE;
+}
+
+void CPU::account(uint64_t weight) {
+  uint64_t slots = weight * stalled_slots;
+  switch (last_slot) {
+    case Slot::ISSUED: break;
+    case Slot::FRONTEND: slots_frontend += slots; break;
+    case Slot::BACKEND_MEMORY: slots_backend_memory += slots; break;
+    case Slot::BACKEND_CORE: slots_backend_core += slots; break;
+    case Slot::WRONG_PATH: slots_wrong_path += slots; break;
+  }
+  if (profiler != nullptr) {
+    profiler->add_cycles(rob.is_empty() ? mem.get_PC() : rob.front().pc, weight);
+  }
+  if (callstack != nullptr) callstack->add_cycles(weight);
+  rob_occupancy.add(rob.get_size(), weight);
+  rs_occupancy.add(RS.get_size(), weight);
+  lsb_occupancy.add(LSB.get_size(), weight);
+}
+
+bool CPU::tick() {
+  PIPE_LOG(for (uint32_t id : pipe_writeback) pipe_stage(id, PipeStage::WRITEBACK), pipe_writeback.clear());
+  bool progress = false;
+  for (uint32_t i = 0; i < width && commit_stage(); ++i) {
+    progress = true;
+    if (halted) return true;
+  }
+  if (memory_stage()) progress = true;
+  if (execute_stage()) progress = true;
+  uint32_t n = 0;
+  while (n < width && issue_stage()) n++;
+  if (n > 0) progress = true;
+  stalled_slots = width - n;
+  last_slot = n == width ? Slot::ISSUED : classify_stall();
+  account(1);
+  cycle++;
+  if (sampler != nullptr) maybe_sample();
+  return progress;
+}
+
+void CPU::run(bool skip_idle, uint64_t max_insts, uint64_t until) {
+  uint64_t limit = max_insts == UINT64_MAX ? UINT64_MAX : instret + max_insts;
+  while (!halted && instret < limit && cycle < until) {
+    if (tick() || !skip_idle) continue;
+    uint64_t next;
+    if (events.next(cycle, next)) {
+      next = std::min(next, until);
+      // 被跳过的周期与刚才的空转周期完全相同
+      account(next - cycle);
+      if (sampler != nullptr && !sample_by_insts) {
+        while (next_sample <= next) {
+          sampler->record(snapshot(next_sample));
+          next_sample += sample_interval;
+        }
+      }
+      cycle = next;
+    }
+  }
+  if (sampler != nullptr) sampler->record(snapshot(cycle));
+}
+
+void CPU::leave_detailed() {
+  flush_pipeline(rob.is_empty() ? mem.get_PC() : rob.front().pc);
+  while (!ms.is_idle()) {
+    mem_done.clear();
+    ms.tick(cycle, mem_done);
+    uint64_t next;
+    cycle = events.next(cycle + 1, next) ? next : cycle + 1;
+  }
+}
+
+void CPU::print_stats(std::ostream& os) const {
+  double ipc = cycle ? static_cast<double>(instret) / cycle : 0.0;
+  os << "cycles " << cycle << "\n"
+     << "instructions " << instret << "\n"
+     << std::fixed << std::setprecision(3)
+     << "ipc " << ipc << "\n"
+     << "branch_mispredicts " << mispredicts << "\n";
+  os.unsetf(std::ios::fixed);
+  ms.print_stats(os, cycle);
+}
@@ -0,0 +1,158 @@
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include "../include/cpusim.h"
+#include "../include/cpu.cpp"
+#include "../include/loader.cpp"
+#include "../include/options.cpp"
+
+// libcpusim：把 CPU 包成 C 接口，CPU 的实现在 lib/cpu.cpp。
+// 对外只导出 cpusim.h 中的函数，C++ 异常不会越过接口
+
+const char CPUSIM_VERSION[] = "1.0";
+
+struct cpusim {
+  std::unique_ptr<CPU> cpu;
+  std::string error;
+  uint64_t functional_insts = 0;
+  bool detailed = false;   // 上次用乱序模型运行且没有停机，流水线里可能还有未提交的指令
+};
+
+namespace {
+
+// 出错时记下原因并返回 fail
+template <typename F, typename R>
+R guarded(cpusim_t* sim, R fail, F f) {
+  try {
+    return f();
+  } catch (const std::exception& e) {
+    sim->error = e.what();
+  } catch (...) {
+    sim->error = "unknown error";
+  }
+  return fail;
+}
+
+int load(cpusim_t* sim, std::istream& in) {
+  uint32_t lo, hi;
+  load_image(*sim->cpu, in, lo, hi);
+  sim->cpu->cpu_set_PC(0x0);
+  return 0;
+}
+
+}  // namespace
+
+extern "C" {
+
+const char* cpusim_version(void) {
+  return CPUSIM_VERSION;
+}
+
+cpusim_t* cpusim_create(const char* const* options, int count) {
+  try {
+    Cache_Config l1;
+    DRAM_Config dram;
+    Core_Config core;
+    for (int i = 0; i < count; ++i) {
+      if (!parse_config_option(options[i], l1, dram, core)) return nullptr;
+    }
+    auto sim = std::make_unique<cpusim>();
+    sim->cpu = std::make_unique<CPU>(l1, dram, core);
+    sim->cpu->set_output(nullptr);
+    return sim.release();
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void cpusim_destroy(cpusim_t* sim) {
+  delete sim;
+}
+
+const char* cpusim_last_error(const cpusim_t* sim) {
+  return sim->error.c_str();
+}
+
+int cpusim_load_image(cpusim_t* sim, const char* text, size_t length) {
+  return guarded(sim, static_cast<int>(CPUSIM_ERROR), [&] {
+    std::istringstream in(std::string(text, length));
+    return load(sim, in);
+  });
+}
+
+int cpusim_load_image_file(cpusim_t* sim, const char* path) {
+  return guarded(sim, static_cast<int>(CPUSIM_ERROR), [&] {
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error(std::string("cannot open ") + path);
+    return load(sim, in);
+  });
+}
+
+int cpusim_run(cpusim_t* sim, int mode, uint64_t max_insts) {
+  return guarded(sim, static_cast<int>(CPUSIM_ERROR), [&] {
+    CPU& cpu = *sim->cpu;
+    if (mode == CPUSIM_OOO) {
+      cpu.run(true, max_insts);
+      sim->detailed = !cpu.is_halted();
+    } else if (mode == CPUSIM_FUNCTIONAL) {
+      if (sim->detailed) cpu.leave_detailed();
+      sim->detailed = false;
+      sim->functional_insts += cpu.run_functional(max_insts);
+    } else {
+      throw std::runtime_error("unknown mode " + std::to_string(mode));
+    }
+    return cpu.is_halted() ? CPUSIM_HALTED : CPUSIM_LIMIT;
+  });
+}
+
+int cpusim_is_halted(const cpusim_t* sim) {
+  return sim->cpu->is_halted();
+}
+
+uint32_t cpusim_exit_code(const cpusim_t* sim) {
+  return sim->cpu->get_exit_code();
+}
+
+uint32_t cpusim_get_pc(const cpusim_t* sim) {
+  return sim->detailed ? sim->cpu->get_committed_PC() : sim->cpu->get_PC();
+}
+
+uint32_t cpusim_get_reg(const cpusim_t* sim, unsigned index) {
+  return index < 32 ? sim->cpu->get_register(index) : 0;
+}
+
+uint32_t cpusim_read_word(const cpusim_t* sim, uint32_t addr) {
+  return sim->cpu->read_memory_word(addr);
+}
+
+void cpusim_write_word(cpusim_t* sim, uint32_t addr, uint32_t value) {
+  for (uint32_t i = 0; i < 4; ++i) sim->cpu->cpu_write_byte(addr + i, static_cast<uint8_t>(value >> (8 * i)));
+}
+
+uint64_t cpusim_instructions(const cpusim_t* sim) {
+  return sim->functional_insts + sim->cpu->get_instret();
+}
+
+int cpusim_get_counter(const cpusim_t* sim, const char* name, uint64_t* value) {
+  for (const auto& [counter, v] : sim->cpu->get_stats().get_counters()) {
+    if (counter == name) {
+      *value = *v;
+      return 0;
+    }
+  }
+  return CPUSIM_ERROR;
+}
+
+int cpusim_counter_count(const cpusim_t* sim) {
+  return static_cast<int>(sim->cpu->get_stats().get_counters().size());
+}
+
+const char* cpusim_counter_name(const cpusim_t* sim, int index) {
+  const auto& counters = sim->cpu->get_stats().get_counters();
+  if (index < 0 || index >= static_cast<int>(counters.size())) return nullptr;
+  return counters[index].first.c_str();
+}
+
+}
@@ -4,34 +4,264 @@
 #include <vector>
 #include <algorithm>
 #include <fstream>
+#include <cstring>
+#include <memory>
 #include "include/cpu.cpp"
-int main() {
+#include "include/loader.cpp"
+#include "include/oracle.cpp"
+#include "include/simpoint.cpp"
+#include "include/debugger.cpp"
+#include "include/options.cpp"
+#include "include/forkserver.cpp"
+#include "include/resultcache.cpp"
+#include "include/batch.cpp"
+#include "include/sweep.cpp"
+#include "include/daemon.cpp"
+#include "include/coherence.cpp"
+#include "include/multihart.cpp"
+#include "include/multicore.cpp"
+#include "include/smt.cpp"
+
+static int run(int argc, char** argv) {
   //freopen("testcases/2.out", "w", stdout);
   //std::ifstream infile("testcases/array_test2.data");
-  std::string s;
-  CPU cpu;
-  uint32_t store_pos;//扫一遍输入 写入指令的位置
-  std::vector<uint8_t> temp_instructions;
-  while (std::getline(std::cin, s)) {
-    if (s.empty()) continue;
-    if (s[0] == '@') {
-      store_pos = static_cast<uint32_t>(std::stoi(s.substr(1), nullptr, 16));
-    } else {
-      s.erase(std::remove(s.begin(), s.end(), ' '), s.end());
-      std::string temp = "";
-      for (int i = 0; i < s.length(); i++) {
-        if (i % 2 == 0) {
-          temp = "";
-          temp += s[i];
-        } else {
-          temp += s[i];
-          uint8_t byte = static_cast<uint8_t>(std::stoi(temp, nullptr, 16));
-          cpu.cpu_write_byte(store_pos, byte);
-          store_pos += 1;
-        }
+  bool ooo = false;
+  bool skip_idle = true;
+  std::string stats_json;
+  std::string interval_out;
+  uint64_t interval = 0;
+  bool interval_by_insts = false;
+  std::string profile_out;
+  std::string symbols_file;
+  std::string flamegraph_out;
+  std::string functions_out;
+  std::string trace_out;
+  std::string replay_file;
+  bool decoupled = false;
+  std::string pipeline_log;
+  bool simpoint = false;
+  std::string checkpoint_out;
+  uint64_t checkpoint_at = UINT64_MAX;
+  uint64_t checkpoint_pc = UINT64_MAX;
+  uint64_t checkpoint_every = 0;
+  std::string restore_file;
+  std::string debug_script;
+  std::string fork_jobs;
+  std::string batch_manifest;
+  std::string sweep_spec;
+  std::string daemon_socket;
+  std::string multicore_manifest;
+  std::vector<uint64_t> quanta;
+  std::string smt_manifest;
+  SMT_Config smt_config;
+  SweepConfig sweep_config;
+  uint64_t max_insts = UINT64_MAX;
+  std::string result_cache_dir;
+  uint64_t result_cache_size = 256ull << 20;
+  uint64_t fork_at = 0;
+  uint64_t fork_warmup = 100000;
+  unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
+  uint32_t harts = 1;
+  bool coherence = false;
+  uint64_t snapshot_every = 100000;
+  SimPointConfig simpoint_config;
+  Cache_Config l1_config;
+  DRAM_Config dram_config;
+  Core_Config core_config;
+  for (int i = 1; i < argc; ++i) {
+    std::string value;
+    if (std::strcmp(argv[i], "--ooo") == 0) {
+      ooo = true;
+    } else if (std::strcmp(argv[i], "--no-skip") == 0) {
+      skip_idle = false;
+    } else if (parse_config_option(argv[i], l1_config, dram_config, core_config)) {
+      continue;
+    } else if (parse_option(argv[i], "--stats-json", value)) {
+      stats_json = value;
+    } else if (parse_option(argv[i], "--interval", value)) {
+      interval = std::stoull(value);
+    } else if (parse_option(argv[i], "--interval-unit", value)) {
+      interval_by_insts = (value == "insts");
+    } else if (parse_option(argv[i], "--interval-out", value)) {
+      interval_out = value;
+    } else if (parse_option(argv[i], "--profile", value)) {
+      profile_out = value;
+    } else if (parse_option(argv[i], "--flamegraph", value)) {
+      flamegraph_out = value;
+    } else if (parse_option(argv[i], "--functions", value)) {
+      functions_out = value;
+    } else if (parse_option(argv[i], "--trace", value)) {
+      trace_out = value;
+    } else if (parse_option(argv[i], "--replay", value)) {
+      replay_file = value;
+      ooo = true;
+    } else if (std::strcmp(argv[i], "--decoupled") == 0) {
+      decoupled = true;
+      ooo = true;
+    } else if (parse_option(argv[i], "--pipeline-log", value)) {
+#ifdef PIPELINE_LOG
+      pipeline_log = value;
+#else
+      std::cerr << "--pipeline-log requires a build with -DPIPELINE_LOG=ON" << std::endl;
+      return 1;
+#endif
+    } else if (std::strcmp(argv[i], "--simpoint") == 0) {
+      simpoint = true;
+    } else if (parse_option(argv[i], "--simpoint-interval", value)) {
+      simpoint_config.interval = std::stoull(value);
+    } else if (parse_option(argv[i], "--simpoint-k", value)) {
+      simpoint_config.max_k = std::stoul(value);
+    } else if (parse_option(argv[i], "--simpoint-warmup", value)) {
+      simpoint_config.warmup = std::stoull(value);
+    } else if (parse_option(argv[i], "--simpoint-samples", value)) {
+      simpoint_config.samples = std::stoul(value);
+    } else if (parse_option(argv[i], "--checkpoint-out", value)) {
+      checkpoint_out = value;
+    } else if (parse_option(argv[i], "--checkpoint-at", value)) {
+      checkpoint_at = std::stoull(value);
+    } else if (parse_option(argv[i], "--checkpoint-pc", value)) {
+      checkpoint_pc = std::stoull(value, nullptr, 0);
+    } else if (parse_option(argv[i], "--checkpoint-every", value)) {
+      checkpoint_every = std::stoull(value);
+    } else if (parse_option(argv[i], "--fork", value)) {
+      fork_jobs = value;
+    } else if (parse_option(argv[i], "--fork-at", value)) {
+      fork_at = std::stoull(value);
+    } else if (parse_option(argv[i], "--fork-warmup", value)) {
+      fork_warmup = std::stoull(value);
+    } else if (parse_option(argv[i], "--jobs", value)) {
+      jobs = std::max(1ul, std::stoul(value));
+    } else if (parse_option(argv[i], "--harts", value)) {
+      harts = std::max(1ul, std::stoul(value));
+    } else if (std::strcmp(argv[i], "--coherence") == 0) {
+      coherence = true;
+    } else if (parse_option(argv[i], "--smt", value)) {
+      smt_manifest = value;
+    } else if (parse_option(argv[i], "--fetch-policy", value)) {
+      smt_config.fetch = parse_fetch_policy(value);
+    } else if (parse_option(argv[i], "--rob-partition", value)) {
+      if (value != "static" && value != "dynamic") {
+        std::cerr << "--rob-partition must be static or dynamic" << std::endl;
+        return 1;
       }
+      smt_config.dynamic_rob = value == "dynamic";
+    } else if (parse_option(argv[i], "--multicore", value)) {
+      multicore_manifest = value;
+    } else if (parse_option(argv[i], "--quantum", value)) {
+      std::istringstream list(value);
+      std::string q;
+      while (std::getline(list, q, ',')) quanta.push_back(std::stoull(q));
+    } else if (parse_option(argv[i], "--batch", value)) {
+      batch_manifest = value;
+    } else if (parse_option(argv[i], "--daemon", value)) {
+      daemon_socket = value;
+    } else if (parse_option(argv[i], "--sweep", value)) {
+      sweep_spec = value;
+    } else if (parse_option(argv[i], "--sweep-out", value)) {
+      sweep_config.out = value;
+    } else if (parse_option(argv[i], "--sweep-samples", value)) {
+      sweep_config.samples = std::stoul(value);
+    } else if (parse_option(argv[i], "--sweep-seed", value)) {
+      sweep_config.seed = std::stoul(value);
+    } else if (parse_option(argv[i], "--result-cache", value)) {
+      result_cache_dir = value;
+    } else if (parse_option(argv[i], "--result-cache-size", value)) {
+      result_cache_size = std::stoull(value);
+    } else if (parse_option(argv[i], "--max-insts", value)) {
+      max_insts = std::stoull(value);
+    } else if (parse_option(argv[i], "--debug", value)) {
+      debug_script = value;
+    } else if (parse_option(argv[i], "--snapshot-every", value)) {
+      snapshot_every = std::stoull(value);
+    } else if (parse_option(argv[i], "--restore", value)) {
+      restore_file = value;
+    } else if (parse_option(argv[i], "--symbols", value)) {
+      symbols_file = value;
+    } else {
+      std::cerr << "unknown option: " << argv[i] << std::endl;
+      return 1;
     }
   }
+  if (!checkpoint_out.empty() && ooo) {
+    std::cerr << "checkpoints are taken in functional mode; drop --ooo/--replay" << std::endl;
+    return 1;
+  }
+  if (!profile_out.empty() && !replay_file.empty()) {
+    std::cerr << "--profile needs the program image, which a replayed trace does not carry; drop --replay" << std::endl;
+    return 1;
+  }
+  if (decoupled && !replay_file.empty()) {
+    std::cerr << "--decoupled produces its own oracle stream; drop --replay" << std::endl;
+    return 1;
+  }
+  if (harts > 1 && ooo) {
+    std::cerr << "multiple harts run in functional mode only; drop --ooo/--replay" << std::endl;
+    return 1;
+  }
+  if (simpoint) {
+    std::string image((std::istreambuf_iterator<char>(std::cin)), std::istreambuf_iterator<char>());
+    SimPoint::run(image, l1_config, dram_config, core_config, simpoint_config, skip_idle, std::cerr);
+    return 0;
+  }
+  if (!daemon_socket.empty()) {
+    SimDaemon daemon(daemon_socket, l1_config, dram_config, core_config, skip_idle);
+    daemon.run(jobs, std::cerr);
+    return 0;
+  }
+  if (!multicore_manifest.empty()) {
+    // 一个 quantum 时直接运行；给出多个时报告各 quantum 相对 quantum 1 的误差和加速比
+    std::vector<BatchJob> tasks = load_batch_manifest(multicore_manifest, l1_config, dram_config, core_config);
+    if (quanta.empty()) quanta.push_back(1000);
+    if (quanta.size() > 1) {
+      MultiCore::tradeoff(std::cout, tasks, dram_config, quanta, skip_idle);
+      return 0;
+    }
+    MultiCore sim(tasks, dram_config, quanta[0], skip_idle);
+    double seconds = sim.run(tasks.size());
+    MultiCore::print(std::cout, sim.results());
+    std::cerr << tasks.size() << " cores, quantum " << quanta[0] << ", " << seconds << " s" << std::endl;
+    return 0;
+  }
+  if (!smt_manifest.empty()) {
+    // 所有线程共用一个核，配置只取命令行
+    std::vector<BatchJob> tasks = load_batch_manifest(smt_manifest, l1_config, dram_config, core_config);
+    SMTCore core(tasks, l1_config, dram_config, core_config, smt_config);
+    core.run(skip_idle);
+    SMTCore::report(std::cout, core.results(), core.get_cycle(),
+                    SMTCore::run_alone(tasks, l1_config, dram_config, core_config, skip_idle));
+    return 0;
+  }
+  std::unique_ptr<ResultCache> result_cache;
+  if (!result_cache_dir.empty()) result_cache = std::make_unique<ResultCache>(result_cache_dir, result_cache_size);
+  if (!sweep_spec.empty()) {
+    sweep_config.max_insts = max_insts;
+    sweep_config.skip_idle = skip_idle;
+    sweep_config.jobs = jobs;
+    Sweep sweep(sweep_spec);
+    size_t failed = sweep.run(sweep_config, l1_config, dram_config, core_config, result_cache.get(), std::cerr);
+    if (result_cache) result_cache->report(std::cerr);
+    return failed == 0 ? 0 : 1;
+  }
+  if (!batch_manifest.empty()) {
+    std::vector<BatchJob> tasks = load_batch_manifest(batch_manifest, l1_config, dram_config, core_config);
+    BatchRunner runner(tasks, ooo, skip_idle, max_insts);
+    runner.set_cache(result_cache.get());
+    runner.run(jobs);
+    size_t failed = runner.report(std::cout, std::cerr);
+    if (result_cache) result_cache->report(std::cerr);
+    return failed == 0 ? 0 : 1;
+  }
+  CPU cpu(l1_config, dram_config, core_config);
+  uint32_t image_lo = UINT32_MAX, image_hi = 0;   // 载入镜像的地址范围
+  // 回放 trace 或从 checkpoint 恢复时不需要程序镜像
+  uint64_t executed = 0;
+  if (!restore_file.empty()) {
+    executed = cpu.restore_checkpoint(restore_file);
+    resident_range(cpu, cpu.get_PC(), image_lo, image_hi);
+  } else if (replay_file.empty()) {
+    load_image(cpu, std::cin, image_lo, image_hi);
+    cpu.cpu_set_PC(0x0);
+  }
   //uint32_t temp = 0;
   //while (temp < store_pos) {
   //  cpu.set_PC(temp);
@@ -45,10 +275,150 @@ int main() {
   //  std::cout << Instruction(inst).get_op() << std::endl;
   //  temp += 4;
   //}
-  cpu.cpu_set_PC(0x0);
-  while (true) {
-    cpu.cpu_reset();
-    uint32_t inst = cpu.get_instruction();
-    cpu.execute(inst);
+  if (!fork_jobs.empty()) {
+    std::ifstream in(fork_jobs);
+    if (!in) {
+      std::cerr << "cannot open " << fork_jobs << std::endl;
+      return 1;
+    }
+    std::vector<ForkJob> tasks = load_fork_jobs(in, l1_config, dram_config, core_config);
+    WarmupRecorder warm(fork_warmup);
+    cpu.set_tracer(&warm);
+    if (fork_at > executed) executed += cpu.run_functional(fork_at - executed);
+    cpu.set_tracer(nullptr);
+    ForkServer::run(cpu, tasks, warm, skip_idle, jobs, std::cout);
+    return 0;
+  }
+  if (harts > 1) {
+    // 一致性模型的私有 L1 用 --l1-size / --l1-ways 的配置
+    std::unique_ptr<CoherenceModel> model;
+    if (coherence) model = std::make_unique<CoherenceModel>(harts, l1_config);
+    MultiHart::run(cpu, harts, max_insts, std::cerr, model.get());
+    return 0;
+  }
+  // 只缓存程序输出和统计，要求别的输出时照常运行
+  bool side_outputs = !stats_json.empty() || !interval_out.empty() || !profile_out.empty() ||
+                      !flamegraph_out.empty() || !functions_out.empty() || !trace_out.empty() ||
+                      !pipeline_log.empty() || !checkpoint_out.empty() || !debug_script.empty();
+  std::string cache_key;
+  if (result_cache && replay_file.empty() && !side_outputs) {
+    // max_insts 限制先行模式 oracle 流的长度
+    std::string mode = !ooo ? "functional" : decoupled ? "decoupled:" + std::to_string(max_insts) : "ooo";
+    cache_key = result_cache->key(cpu, mode, config_key(l1_config, dram_config, core_config));
+    CachedResult cached;
+    if (result_cache->lookup(cache_key, cached)) {
+      if (cached.halted) std::cout << cached.exit_code << std::endl;
+      std::cerr << cached.stats;
+      result_cache->report(std::cerr);
+      return 0;
+    }
+  }
+  std::unique_ptr<Profiler> profiler;
+  if (!profile_out.empty() && image_lo < image_hi) {
+    profiler = std::make_unique<Profiler>(image_lo, image_hi);
+    cpu.set_profiler(profiler.get());
+  }
+  std::unique_ptr<CallProfiler> callstack;
+  if (!flamegraph_out.empty() || !functions_out.empty()) {
+    callstack = std::make_unique<CallProfiler>(cpu.get_PC());
+    cpu.set_call_profiler(callstack.get());
+  }
+  std::unique_ptr<TraceWriter> tracer;
+  if (!trace_out.empty()) {
+    tracer = std::make_unique<TraceWriter>(trace_out);
+    cpu.set_tracer(tracer.get());
+  }
+  std::unique_ptr<TraceReader> replay;
+  if (!replay_file.empty()) {
+    replay = std::make_unique<TraceReader>(replay_file);
+    cpu.set_replay(replay.get());
+  }
+  // 功能模型在另一个线程里先行，乱序模型回放它送来的 oracle 流
+  std::unique_ptr<FunctionalOracle> oracle;
+  if (decoupled) {
+    oracle = std::make_unique<FunctionalOracle>(cpu, max_insts);
+    cpu.set_replay(oracle->source(), true);
+  }
+  if (ooo) {
+    std::unique_ptr<IntervalSampler> sampler;
+    if (interval != 0 && !interval_out.empty()) {
+      sampler = std::make_unique<IntervalSampler>(interval_out);
+      cpu.set_sampler(sampler.get(), interval, interval_by_insts);
+    }
+#ifdef PIPELINE_LOG
+    std::unique_ptr<KanataWriter> kanata;
+    if (!pipeline_log.empty()) {
+      kanata = std::make_unique<KanataWriter>(pipeline_log);
+      cpu.set_pipeline_log(kanata.get());
+    }
+#endif
+    cpu.run(skip_idle);
+    if (oracle) oracle->stop(std::cerr);
+    if (sampler) sampler->stop();
+#ifdef PIPELINE_LOG
+    if (kanata) kanata->stop();
+#endif
+    cpu.print_stats(std::cerr);
+    if (!stats_json.empty()) {
+      std::ofstream out(stats_json);
+      cpu.dump_stats_json(out);
+    }
+  } else if (!debug_script.empty()) {
+    // 调试命令从文件读入，交互使用时可以给 /dev/tty
+    std::ifstream commands(debug_script);
+    if (!commands) {
+      std::cerr << "cannot open " << debug_script << std::endl;
+      return 1;
+    }
+    ReverseDebugger debugger(cpu, std::cout, snapshot_every);
+    debugger.run(commands);
+  } else {
+    // 周期 checkpoint 写成 <out>.<指令数>，第一个是完整的（从 checkpoint 恢复时则接在它后面），之后都是增量
+    bool checkpoint_saved = checkpoint_out.empty() || checkpoint_every != 0;
+    std::string last_checkpoint = restore_file;
+    while (!cpu.is_halted()) {
+      if (!checkpoint_saved && (executed == checkpoint_at || cpu.get_PC() == checkpoint_pc)) {
+        cpu.save_checkpoint(checkpoint_out, executed);
+        checkpoint_saved = true;
+      }
+      if (checkpoint_every != 0 && !checkpoint_out.empty() && executed != 0 && executed % checkpoint_every == 0) {
+        std::string path = checkpoint_out + "." + std::to_string(executed);
+        if (path != last_checkpoint) {
+          cpu.save_checkpoint(path, executed, last_checkpoint);
+          last_checkpoint = path;
+        }
+      }
+      executed += cpu.run_functional(1);
+    }
+  }
+  if (tracer) tracer->stop();
+  if (!cache_key.empty()) {
+    result_cache->store(cache_key, capture_result(cpu, ooo));
+    result_cache->report(std::cerr);
+  }
+  SymbolTable syms;
+  bool have_syms = !symbols_file.empty() && syms.load(symbols_file);
+  if (profiler) {
+    std::ofstream out(profile_out);
+    cpu.write_profile(out, have_syms ? &syms : nullptr);
+  }
+  if (callstack && !flamegraph_out.empty()) {
+    std::ofstream out(flamegraph_out);
+    callstack->write_folded(out, have_syms ? &syms : nullptr);
+  }
+  if (callstack && !functions_out.empty()) {
+    std::ofstream out(functions_out);
+    callstack->write_functions(out, have_syms ? &syms : nullptr);
+  }
+  return 0;
+}
+
+// 用户输入导致的错误（配置非法、文件打不开等）以异常报出，在这里打印并返回 1
+int main(int argc, char** argv) {
+  try {
+    return run(argc, argv);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
   }
 }
\ No newline at end of file
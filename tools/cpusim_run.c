@@ -0,0 +1,48 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "../include/cpusim.h"
+
+/* 只依赖 libcpusim 的最小驱动：cpusim_run [--ooo] [配置选项...] 镜像文件
+ * 打印程序返回值，乱序模式下再把全部计数器打到标准错误 */
+
+int main(int argc, char** argv) {
+  int mode = CPUSIM_FUNCTIONAL;
+  const char* options[64];
+  int count = 0;
+  const char* image = NULL;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--ooo") == 0) {
+      mode = CPUSIM_OOO;
+    } else if (strncmp(argv[i], "--", 2) == 0 && count < 64) {
+      options[count++] = argv[i];
+    } else {
+      image = argv[i];
+    }
+  }
+  if (image == NULL) {
+    fprintf(stderr, "usage: %s [--ooo] [options...] image.data\n", argv[0]);
+    return 1;
+  }
+  cpusim_t* sim = cpusim_create(options, count);
+  if (sim == NULL) {
+    fprintf(stderr, "invalid options\n");
+    return 1;
+  }
+  if (cpusim_load_image_file(sim, image) != 0 || cpusim_run(sim, mode, UINT64_MAX) == CPUSIM_ERROR) {
+    fprintf(stderr, "%s\n", cpusim_last_error(sim));
+    cpusim_destroy(sim);
+    return 1;
+  }
+  printf("%u\n", cpusim_exit_code(sim));
+  if (mode == CPUSIM_OOO) {
+    for (int i = 0; i < cpusim_counter_count(sim); ++i) {
+      const char* name = cpusim_counter_name(sim, i);
+      uint64_t value = 0;
+      cpusim_get_counter(sim, name, &value);
+      fprintf(stderr, "%s %llu\n", name, (unsigned long long)value);
+    }
+  }
+  cpusim_destroy(sim);
+  return 0;
+}
@@ -0,0 +1,70 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+#include "../include/cpu.cpp"
+#include "../include/loader.cpp"
+#include "../include/dataflow.cpp"
+#include "../include/options.cpp"
+
+// 数据流关键路径 / ILP 极限分析。
+// 用法：ilp --trace=FILE 分析已有的 trace，不给 --trace 时从标准输入读程序镜像并用功能模型运行；
+// --history=N 是回溯关键路径时保留的最近指令数
+
+int main(int argc, char** argv) {
+  std::string trace_file;
+  std::string symbols_file;
+  std::vector<uint32_t> windows = {32, 64, 128, 256, 512, 1024};
+  uint32_t load_latency = 1;
+  size_t top = 20;
+  uint64_t history = 1 << 20;
+  for (int i = 1; i < argc; ++i) {
+    std::string value;
+    if (parse_option(argv[i], "--trace", value)) {
+      trace_file = value;
+    } else if (parse_option(argv[i], "--windows", value)) {
+      windows.clear();
+      std::istringstream ss(value);
+      std::string item;
+      while (std::getline(ss, item, ',')) windows.push_back(std::stoul(item));
+      if (std::count(windows.begin(), windows.end(), 0u) != 0) {
+        std::cerr << "--windows sizes must be at least 1" << std::endl;
+        return 1;
+      }
+    } else if (parse_option(argv[i], "--load-latency", value)) {
+      load_latency = std::stoul(value);
+    } else if (parse_option(argv[i], "--history", value)) {
+      history = std::stoull(value);
+    } else if (parse_option(argv[i], "--top", value)) {
+      top = std::stoul(value);
+    } else if (parse_option(argv[i], "--symbols", value)) {
+      symbols_file = value;
+    } else {
+      std::cerr << "unknown option: " << argv[i] << std::endl;
+      return 1;
+    }
+  }
+
+  DataflowAnalyzer analyzer(windows, load_latency, history);
+  if (!trace_file.empty()) {
+    TraceReader reader(trace_file);
+    TraceRecord r;
+    while (reader.next(r)) analyzer.add(r);
+  } else {
+    CPU cpu;
+    cpu.set_output(nullptr);
+    uint32_t lo, hi;
+    load_image(cpu, std::cin, lo, hi);
+    cpu.cpu_set_PC(0x0);
+    DataflowSink sink(analyzer);
+    cpu.set_tracer(&sink);
+    cpu.run_functional();
+  }
+
+  SymbolTable syms;
+  bool have_syms = !symbols_file.empty() && syms.load(symbols_file);
+  analyzer.report(std::cout, have_syms ? &syms : nullptr, top);
+  return 0;
+}